@@ -0,0 +1,219 @@
+/**
+ * @file contention.cpp
+ * @author silvio3105 (www.github.com/silvio3105)
+ * @brief FLASH controller contention benchmark on host.
+ *
+ * Host threads model tasks of single core MCU, each task writes its own \ref sEEPROM object in shared EEPROM as fast as it can.
+ * Same workload is run with every arbitration policy and throughput, wait time in take handler and share of writes per task are compared.
+ * After each run every task checks its EEPROM area and EEPROM must be locked.
+ *
+ * Build and run from repository root:
+ * g++ -std=c++17 -O2 -pthread -DSTM32L051xx -Iexamples/host -I. sEEPROM.cpp examples/host/contention.cpp -o contention && ./contention 4 200
+ *
+ * Arguments are number of tasks and run time of each policy in milliseconds.
+ *
+ * @copyright Copyright (c) 2023, silvio3105
+ *
+ */
+
+/*
+License
+
+Copyright (c) 2023, silvio3105 (www.github.com/silvio3105)
+
+Access and use of this Project and its contents are granted free of charge to any Person.
+The Person is allowed to copy, modify and use The Project and its contents only for non-commercial use.
+Commercial use of this Project and its contents is prohibited.
+Modifying this License and/or sublicensing is prohibited.
+
+THE PROJECT AND ITS CONTENT ARE PROVIDED "AS IS" WITH ALL FAULTS AND WITHOUT EXPRESSED OR IMPLIED WARRANTY.
+THE AUTHOR KEEPS ALL RIGHTS TO CHANGE OR REMOVE THE CONTENTS OF THIS PROJECT WITHOUT PREVIOUS NOTICE.
+THE AUTHOR IS NOT RESPONSIBLE FOR DAMAGE OF ANY KIND OR LIABILITY CAUSED BY USING THE CONTENTS OF THIS PROJECT.
+
+This License shall be included in all methodal textual files.
+*/
+
+
+// ----- INCLUDE FILES
+#include			"sEEPROM.h"
+#include			<stdio.h>
+#include			<stdlib.h>
+#include			<atomic>
+#include			<chrono>
+#include			<mutex>
+#include			<thread>
+#include			<vector>
+
+
+// ----- DEFINES
+#define MAX_TASKS				16 /**< @brief Maximum number of tasks. */
+#define WRITE_LEN				16 /**< @brief Bytes per write. */
+
+
+// ----- TYPEDEFS
+typedef std::chrono::steady_clock clk; /**< @brief Benchmark clock. */
+
+
+// ----- STRUCTS
+/**
+ * @brief Task result.
+ *
+ */
+struct result {
+	uint32_t writes = 0; /**< @brief Number of writes. */
+	uint64_t waitNs = 0; /**< @brief Total time spent in take handler. */
+	uint64_t maxNs = 0; /**< @brief Longest time spent in take handler. */
+	uint8_t ok = 0; /**< @brief Last write is read back from EEPROM. */
+};
+
+
+// ----- VARIABLES
+static std::mutex mutex; /**< @brief Mutex for plain mutex policy. */
+static sEEPROMMutexHandler policyTake = nullptr; /**< @brief Take handler of current policy. */
+static sEEPROMMutexHandler policyGive = nullptr; /**< @brief Give handler of current policy. */
+static std::atomic<uint8_t> running; /**< @brief Tasks keep writing while set. */
+static thread_local result* self = nullptr; /**< @brief Result of calling task. */
+
+
+// ----- FUNCTIONS
+static void mutexTake(void)
+{
+	mutex.lock();
+}
+
+static void mutexGive(void)
+{
+	mutex.unlock();
+}
+
+static void yield(void)
+{
+	std::this_thread::yield();
+}
+
+/**
+ * @brief Take handler which measures time until FLASH controller is taken.
+ *
+ * @return No return value.
+ */
+static void timedTake(void)
+{
+	clk::time_point t0 = clk::now();
+	policyTake();
+	uint64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(clk::now() - t0).count();
+
+	self->waitNs += ns;
+	if (ns > self->maxNs) self->maxNs = ns;
+}
+
+static void timedGive(void)
+{
+	policyGive();
+}
+
+/**
+ * @brief Task body.
+ *
+ * @param id Task ID.
+ * @param tasks Number of tasks.
+ * @param res Pointer to task result.
+ * @return No return value.
+ */
+static void task(uint8_t id, uint8_t tasks, result* res)
+{
+	uint16_t area = (SEEPROM_SIZE / tasks) & ~0x3;
+	sEEPROM eeprom(SEEPROM_START + id * area, area);
+	uint8_t data[WRITE_LEN];
+	uint8_t check[WRITE_LEN];
+	uint16_t offset = 0;
+
+	self = res;
+	while (running)
+	{
+		// Unaligned writes, so head and tail words are read and padded
+		offset = (offset + WRITE_LEN + 1) % (area - WRITE_LEN);
+		for (uint8_t idx = 0; idx < WRITE_LEN; idx++) data[idx] = id + res->writes + idx + 1;
+
+		eeprom.write(offset, data, WRITE_LEN);
+		res->writes++;
+	}
+
+	eeprom.read(offset, check, WRITE_LEN);
+	res->ok = !memcmp(data, check, WRITE_LEN);
+}
+
+
+// ----- MAIN
+int main(int argc, char** argv)
+{
+	uint8_t tasks = 4;
+	uint32_t ms = 200;
+
+	if (argc > 1) tasks = atoi(argv[1]);
+	if (argc > 2) ms = atoi(argv[2]);
+	if (!tasks || tasks > MAX_TASKS || !ms) return 1;
+
+	if (!sEEPROMHost::mount())
+	{
+		printf("contention: Cannot map EEPROM at 0x%08X!\n", SEEPROM_START);
+		return 1;
+	}
+
+	struct {
+		const char* name;
+		sEEPROMMutexHandler take;
+		sEEPROMMutexHandler give;
+	} const policies[] = {
+		{ "irq", sEEPROM::irqTake, sEEPROM::irqGive },
+		{ "mutex", mutexTake, mutexGive },
+		{ "queue", sEEPROM::queueTake, sEEPROM::queueGive }
+	};
+
+	uint8_t fail = 0;
+	sEEPROM::setQueueWait(yield);
+	sEEPROM::setMutex(timedTake, timedGive);
+
+	printf("%u tasks, %u ms per policy, %u byte writes\n\n", tasks, ms, WRITE_LEN);
+	printf("%-8s %10s %12s %12s %10s %6s\n", "policy", "writes/s", "mean wait us", "max wait us", "min/max", "check");
+
+	for (const auto& policy : policies)
+	{
+		result res[MAX_TASKS];
+		std::vector<std::thread> threads;
+
+		sEEPROMHost::mount();
+		policyTake = policy.take;
+		policyGive = policy.give;
+		running = 1;
+
+		for (uint8_t id = 0; id < tasks; id++) threads.emplace_back(task, id, tasks, &res[id]);
+		std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+		running = 0;
+		for (std::thread& thread : threads) thread.join();
+
+		uint64_t writes = 0;
+		uint64_t waitNs = 0;
+		uint64_t maxNs = 0;
+		uint32_t least = 0xFFFFFFFF;
+		uint32_t most = 0;
+		uint8_t ok = (FLASH->PECR & FLASH_PECR_PELOCK) ? 1 : 0;
+
+		for (uint8_t id = 0; id < tasks; id++)
+		{
+			writes += res[id].writes;
+			waitNs += res[id].waitNs;
+			if (res[id].maxNs > maxNs) maxNs = res[id].maxNs;
+			if (res[id].writes < least) least = res[id].writes;
+			if (res[id].writes > most) most = res[id].writes;
+			ok &= res[id].ok;
+		}
+		if (!ok) fail = 1;
+
+		// Share of writes of least served task against most served task
+		printf("%-8s %10.0f %12.2f %12.1f %10.3f %6s\n", policy.name, writes * 1000.0 / ms, writes ? (waitNs / 1000.0) / writes : 0, maxNs / 1000.0, most ? (double)least / most : 0, ok ? "ok" : "FAIL");
+	}
+
+	return fail;
+}
+
+// END WITH NEW LINE
@@ -0,0 +1,672 @@
+/**
+ * @file cutsweep.cpp
+ * @author silvio3105 (www.github.com/silvio3105)
+ * @brief Power cut sweep for sEEPROM layers on host.
+ *
+ * Each scenario is run once per program/erase operation with power cut before(clean) and after(torn) that operation. Torn cuts are repeated with \c TEAR_SEEDS tear patterns.
+ * After cut, driver objects are mounted again and scenario invariants are checked. PECR writes without BSY poll after last program or erase are failures too. Cut points are split between one process per CPU core.
+ *
+ * Build and run from repository root:
+ * g++ -std=c++17 -O2 -DSTM32L051xx -DSEEPROM_FAULT_INJECTION -Iexamples/host -I. sEEPROM.cpp examples/host/cutsweep.cpp -o cutsweep && ./cutsweep
+ *
+ * @copyright Copyright (c) 2023, silvio3105
+ *
+ */
+
+/*
+License
+
+Copyright (c) 2023, silvio3105 (www.github.com/silvio3105)
+
+Access and use of this Project and its contents are granted free of charge to any Person.
+The Person is allowed to copy, modify and use The Project and its contents only for non-commercial use.
+Commercial use of this Project and its contents is prohibited.
+Modifying this License and/or sublicensing is prohibited.
+
+THE PROJECT AND ITS CONTENT ARE PROVIDED "AS IS" WITH ALL FAULTS AND WITHOUT EXPRESSED OR IMPLIED WARRANTY.
+THE AUTHOR KEEPS ALL RIGHTS TO CHANGE OR REMOVE THE CONTENTS OF THIS PROJECT WITHOUT PREVIOUS NOTICE.
+THE AUTHOR IS NOT RESPONSIBLE FOR DAMAGE OF ANY KIND OR LIABILITY CAUSED BY USING THE CONTENTS OF THIS PROJECT.
+
+This License shall be included in all methodal textual files.
+*/
+
+
+// ----- INCLUDE FILES
+#include			"sEEPROM.h"
+#include			<stdio.h>
+#include			<unistd.h>
+#include			<sys/wait.h>
+#include			<time.h>
+
+#ifndef SEEPROM_FAULT_INJECTION
+#error "cutsweep: Build with -DSEEPROM_FAULT_INJECTION!"
+#endif // SEEPROM_FAULT_INJECTION
+
+
+// ----- DEFINES
+#define TEAR_SEEDS				16 /**< @brief Number of tear patterns per torn cut point. */
+
+
+// ----- STRUCTS
+/**
+ * @brief Power cut scenario.
+ *
+ */
+struct scenario {
+	const char* name; /**< @brief Scenario name. */
+	void (*prepare)(void); /**< @brief Write initial EEPROM content. Runs without fault injection. */
+	void (*run)(void); /**< @brief Operations under test. */
+	bool (*check)(void); /**< @brief Mount after cut and check invariants. */
+};
+
+/**
+ * @brief Worker result.
+ *
+ */
+struct result {
+	uint32_t cuts; /**< @brief Number of tested cut points. */
+	uint32_t fails; /**< @brief Number of cut points with broken invariant. */
+};
+
+
+// ----- VARIABLES
+static sEEPROM region(SEEPROM_START, 256); /**< @brief EEPROM area under test. */
+static uint32_t pushed = 0; /**< @brief Number of finished pushes. */
+static uint32_t popped = 0; /**< @brief Number of finished pops. */
+static uint8_t popping = 0; /**< @brief Pop is in progress. */
+
+
+// ----- FIFO SCENARIO
+static void fifoPayload(uint32_t id, uint8_t* out, uint16_t& len)
+{
+	len = 1 + (id * 7) % 23;
+	for (uint16_t idx = 0; idx < len; idx++) out[idx] = (uint8_t)(id * 31 + idx + 1);
+}
+
+static void fifoPrepare(void)
+{
+	pushed = 0;
+	popped = 0;
+	popping = 0;
+}
+
+static void fifoRun(void)
+{
+	sEEPROMFIFO fifo(region);
+	fifo.mount();
+
+	// Fill, drain half, wrap around
+	for (uint8_t step = 0; step < 24; step++)
+	{
+		uint8_t buf[32];
+		uint16_t len;
+
+		if (step % 3 == 2)
+		{
+			popping = 1;
+			if (fifo.pop(buf, sizeof(buf), len) == SEEPROM_OK) popped++;
+			popping = 0;
+			continue;
+		}
+
+		fifoPayload(pushed, buf, len);
+		if (fifo.push(buf, len) == SEEPROM_OK) pushed++;
+	}
+}
+
+static bool fifoCheck(void)
+{
+	sEEPROMFIFO fifo(region);
+	fifo.mount();
+
+	// Unfinished pop may or may not be done, unfinished push may or may not be visible
+	uint32_t id = popped;
+	uint8_t buf[32];
+	uint8_t exp[32];
+	uint16_t len;
+	uint16_t expLen;
+	bool first = true;
+
+	while (fifo.pop(buf, sizeof(buf), len) == SEEPROM_OK)
+	{
+		fifoPayload(id, exp, expLen);
+
+		if (first && popping && (len != expLen || memcmp(buf, exp, len)))
+		{
+			id++;
+			fifoPayload(id, exp, expLen);
+		}
+		first = false;
+
+		if (len != expLen || memcmp(buf, exp, len)) return false;
+		id++;
+	}
+
+	return id >= pushed && id <= pushed + 1;
+}
+
+
+// ----- MIGRATION SCENARIO
+static const uint32_t migrateDef = 0xCAFEBABE;
+static const sEEPROMField migrateOld[] = { { 1, 4, 20, nullptr }, { 2, 40, 8, nullptr } };
+static const sEEPROMField migrateNew[] = { { 1, 9, 20, nullptr }, { 2, 60, 8, nullptr }, { 3, 80, 4, &migrateDef } };
+static const sEEPROMSchema migrateFrom = { 1, migrateOld, 2 };
+static const sEEPROMSchema migrateTo = { 2, migrateNew, 3 };
+static uint8_t migrateData[28];
+
+static void migratePrepare(void)
+{
+	uint32_t version = 1;
+
+	for (uint8_t idx = 0; idx < sizeof(migrateData); idx++) migrateData[idx] = idx * 13 + 1;
+	region.write(0, &version, 4);
+	region.write(4, migrateData, 20);
+	region.write(40, migrateData + 20, 8);
+}
+
+static void migrateRun(void)
+{
+	sEEPROMMigration::migrate(region, 0, 100, migrateFrom, migrateTo);
+}
+
+static bool migrateCheck(void)
+{
+	uint8_t a[20];
+	uint8_t b[8];
+	uint32_t c;
+	uint32_t version;
+
+	if (sEEPROMMigration::migrate(region, 0, 100, migrateFrom, migrateTo) != SEEPROM_OK) return false;
+
+	region.read(0, &version, 4);
+	region.read(9, a, sizeof(a));
+	region.read(60, b, sizeof(b));
+	region.read(80, &c, 4);
+
+	return version == 2 && !memcmp(a, migrateData, 20) && !memcmp(b, migrateData + 20, 8) && c == migrateDef;
+}
+
+
+// ----- CRASH DUMP SCENARIO
+static uint32_t crashOld[8];
+static uint32_t crashNew[8];
+
+static void crashPrepare(void)
+{
+	for (uint8_t idx = 0; idx < 8; idx++)
+	{
+		crashOld[idx] = 0x1000 + idx;
+		crashNew[idx] = 0x2000 + idx * 3;
+	}
+
+	sEEPROMCrash::dump(region, 1, crashOld, 8);
+}
+
+static void crashRun(void)
+{
+	sEEPROMCrash::dump(region, 2, crashNew, 8);
+}
+
+static bool crashCheck(void)
+{
+	uint32_t tag;
+	uint32_t out[8];
+	uint16_t len;
+
+	// Dump is either missing or complete
+	if (sEEPROMCrash::read(region, tag, out, 8, len) != SEEPROM_OK) return true;
+	if (len != 8) return false;
+	if (tag == 1) return !memcmp(out, crashOld, sizeof(out));
+	if (tag == 2) return !memcmp(out, crashNew, sizeof(out));
+
+	return false;
+}
+
+
+// ----- COUNTER SCENARIO
+static sEEPROM counterArea(SEEPROM_START, 48); /**< @brief Small slot ring, so sweep wraps it several times. */
+static uint32_t counted = 0; /**< @brief Number of finished increments. */
+
+template<typename T>
+static T counterStart(void)
+{
+	// Increments carry over byte boundary of 32-bit counter and over word boundary of 64-bit counter
+	return (sizeof(T) == 4) ? 244 : (T)0xFFFFFFF4;
+}
+
+template<typename T>
+static void counterPrepare(void)
+{
+	sEEPROMCounter<T> counter(counterArea);
+	counter.mount();
+	counter.increment(counterStart<T>());
+	counted = 0;
+}
+
+template<typename T>
+static void counterRun(void)
+{
+	sEEPROMCounter<T> counter(counterArea);
+	counter.mount();
+
+	for (uint8_t step = 0; step < 24; step++)
+	{
+		if (counter.increment() == SEEPROM_OK) counted++;
+	}
+}
+
+template<typename T>
+static bool counterCheck(void)
+{
+	sEEPROMCounter<T> counter(counterArea);
+	counter.mount();
+
+	// Unfinished increment may or may not be visible
+	T expect = counterStart<T>() + counted;
+	return counter.value() == expect || counter.value() == (expect + 1);
+}
+
+
+// ----- ECC SCENARIO
+static sEEPROM eccData(SEEPROM_START, 64); /**< @brief ECC data words. */
+static sEEPROM eccCheck(SEEPROM_START + 64, 16); /**< @brief ECC check bytes. */
+static uint32_t eccValues[3][16]; /**< @brief Initial value and values of both updates. */
+
+static void eccPrepare(void)
+{
+	sEEPROMECC ecc(eccData, eccCheck);
+
+	for (uint8_t idx = 0; idx < 16; idx++)
+	{
+		eccValues[0][idx] = 0x11111111 * (idx % 15 + 1);
+		eccValues[1][idx] = eccValues[0][idx] ^ (0x01010101 << (idx % 8));
+		eccValues[2][idx] = ~eccValues[0][idx];
+	}
+
+	ecc.write(0, eccValues[0], 64);
+}
+
+static void eccRun(void)
+{
+	sEEPROMECC ecc(eccData, eccCheck);
+
+	ecc.write(0, eccValues[1], 64);
+	ecc.write(16, eccValues[2] + 4, 32);
+}
+
+static bool eccCheckWords(void)
+{
+	sEEPROMECC ecc(eccData, eccCheck);
+
+	for (uint8_t idx = 0; idx < 16; idx++)
+	{
+		uint32_t word;
+
+		// Interrupted update may be detected, but word must never read as value it never had
+		if (ecc.read(idx * 4, &word, 4) == SEEPROM_ECC) continue;
+		if (word != eccValues[0][idx] && word != eccValues[1][idx] && word != eccValues[2][idx]) return false;
+	}
+
+	return true;
+}
+
+
+// ----- SHADOW SCENARIO
+static uint32_t shadowRAM[16]; /**< @brief RAM shadow of first 64 bytes of region. */
+static uint32_t shadowDirty[1]; /**< @brief Shadow dirty bitmap. */
+static sEEPROM shadowArea(SEEPROM_START, 64); /**< @brief Shadowed area. */
+static uint32_t shadowOld[16]; /**< @brief Values before emergency flush. */
+static uint32_t shadowNew[16]; /**< @brief Values staged for emergency flush. */
+
+static uint8_t shadowPrio(uint8_t word)
+{
+	if (word >= 8 && word < 12) return 2;
+	if (word < 4) return 1;
+
+	return 0;
+}
+
+static void shadowPrepare(void)
+{
+	sEEPROMShadow shadow(shadowArea, shadowRAM, shadowDirty);
+
+	for (uint8_t idx = 0; idx < 16; idx++)
+	{
+		shadowOld[idx] = 0x01020304 * (idx + 1);
+		shadowNew[idx] = ~shadowOld[idx];
+	}
+
+	shadowArea.write(0, shadowOld, sizeof(shadowOld));
+	shadow.load();
+}
+
+static void shadowRun(void)
+{
+	sEEPROMShadow shadow(shadowArea, shadowRAM, shadowDirty);
+	uint16_t lost;
+
+	shadow.load();
+	shadow.setPriority(0, 16, 1);
+	shadow.setPriority(32, 16, 2);
+	shadow.write(0, shadowNew, sizeof(shadowNew));
+	shadow.emergencyFlush(16 * SEEPROM_PROG_TIME_US, lost);
+}
+
+static bool shadowCheck(void)
+{
+	uint32_t words[16];
+	int8_t torn = -1;
+	int16_t lowestNew = 3;
+
+	shadowArea.read(0, words, sizeof(words));
+
+	for (uint8_t idx = 0; idx < 16; idx++)
+	{
+		// Only word which was being programmed may hold neither value
+		if (words[idx] != shadowOld[idx] && words[idx] != shadowNew[idx])
+		{
+			if (torn >= 0) return false;
+			torn = idx;
+		}
+		else if (words[idx] == shadowNew[idx] && shadowPrio(idx) < lowestNew) lowestNew = shadowPrio(idx);
+	}
+
+	// Every word with higher priority than any flushed word is flushed
+	for (uint8_t idx = 0; idx < 16; idx++)
+	{
+		if (shadowPrio(idx) > lowestNew && words[idx] != shadowNew[idx]) return false;
+	}
+
+	return true;
+}
+
+
+// ----- IMAGE SCENARIO
+static uint8_t imageOld[256]; /**< @brief Image before update. */
+static uint8_t imageNew[256]; /**< @brief Image written by update. */
+
+static void imagePrepare(void)
+{
+	static const uint32_t defs[4] = { 0x11223344, 0x55667788, 0x99AABBCC, 0xDDEEFF00 };
+	static const sEEPROMField fieldsOld[] = { { 1, 8, 16, defs }, { 2, 100, 8, defs } };
+	static const sEEPROMField fieldsNew[] = { { 1, 12, 16, defs }, { 2, 100, 4, defs + 2 }, { 3, 200, 12, defs + 1 } };
+	static const sEEPROMSchema layoutOld = { 1, fieldsOld, 2 };
+	static const sEEPROMSchema layoutNew = { 2, fieldsNew, 3 };
+
+	sEEPROMImage::build(imageOld, sizeof(imageOld), layoutOld);
+	sEEPROMImage::build(imageNew, sizeof(imageNew), layoutNew);
+	region.writeImage(imageOld, sizeof(imageOld));
+}
+
+static void imageRun(void)
+{
+	region.writeImage(imageNew, sizeof(imageNew));
+}
+
+static bool imageCheck(void)
+{
+	uint8_t image[256];
+	uint16_t version;
+
+	// Interrupted update must not verify
+	region.read(0, image, sizeof(image));
+	if (sEEPROMImage::verify(image, sizeof(image), version) != SEEPROM_OK) return true;
+
+	return !memcmp(image, (version == 1) ? imageOld : imageNew, sizeof(image));
+}
+
+
+// ----- DEFAULTS SCENARIO
+static const uint8_t defaultsImage[64] = { 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E, 0x0F, 0x10, 0x11, 0x12, 0x13, 0x14 }; /**< @brief Default image. */
+static uint32_t defaultsOld[16]; /**< @brief Image before update. */
+static uint32_t defaultsNew[16]; /**< @brief Image written by update. */
+
+static void defaultsPrepare(void)
+{
+	sEEPROMDefaults defaults(region, defaultsImage, sizeof(defaultsImage));
+	memcpy(defaultsOld, defaultsImage, sizeof(defaultsOld));
+
+	// Every third word is already overridden, so update sets bitmap bits next to set bits
+	for (uint8_t idx = 0; idx < 16; idx++)
+	{
+		if (!(idx % 3)) defaultsOld[idx] = 0xA5000000 | idx;
+		defaultsNew[idx] = 0x5A000000 | (idx << 8) | idx;
+	}
+
+	for (uint8_t idx = 0; idx < 16; idx += 3) defaults.write(idx * 4, &defaultsOld[idx], 4);
+}
+
+static void defaultsRun(void)
+{
+	sEEPROMDefaults defaults(region, defaultsImage, sizeof(defaultsImage));
+	defaults.write(0, defaultsNew, sizeof(defaultsNew));
+}
+
+static bool defaultsCheck(void)
+{
+	sEEPROMDefaults defaults(region, defaultsImage, sizeof(defaultsImage));
+	uint32_t image[16];
+	uint8_t torn = 0;
+
+	defaults.read(0, image, sizeof(image));
+
+	for (uint8_t idx = 0; idx < 16; idx++)
+	{
+		if (image[idx] == defaultsOld[idx] || image[idx] == defaultsNew[idx]) continue;
+
+		// Only in place rewrite of overridden word can tear
+		if (idx % 3) return false;
+		torn++;
+	}
+
+	return torn <= 1;
+}
+
+
+// ----- PATCH SCENARIO
+static uint8_t patchOld[128]; /**< @brief Area before patch. */
+static uint8_t patchNew[128]; /**< @brief Area after patch. */
+static uint8_t patchData[3][40]; /**< @brief Patch bytes. */
+static sEEPROMPatch patchList[3]; /**< @brief Patch list in unsorted order, with overlap and unaligned edges. */
+
+static void patchPrepare(void)
+{
+	for (uint8_t idx = 0; idx < sizeof(patchOld); idx++) patchOld[idx] = idx * 7 + 1;
+	for (uint8_t idx = 0; idx < 3; idx++)
+	{
+		for (uint8_t pos = 0; pos < sizeof(patchData[0]); pos++) patchData[idx][pos] = 0x80 | (idx << 5) | pos;
+	}
+
+	patchList[0] = { 70, 33, patchData[0] };
+	patchList[1] = { 3, 40, patchData[1] };
+	patchList[2] = { 30, 21, patchData[2] };
+
+	// Expected result, where patches overlap patch with higher offset wins
+	memcpy(patchNew, patchOld, sizeof(patchNew));
+	memcpy(patchNew + 3, patchData[1], 40);
+	memcpy(patchNew + 30, patchData[2], 21);
+	memcpy(patchNew + 70, patchData[0], 33);
+
+	region.write(0, patchOld, sizeof(patchOld));
+}
+
+static void patchRun(void)
+{
+	region.patch(patchList, 3);
+}
+
+static bool patchCheck(void)
+{
+	uint32_t area[32];
+	const uint32_t* before = (const uint32_t*)patchOld;
+	const uint32_t* after = (const uint32_t*)patchNew;
+	uint8_t done = 1;
+	uint8_t torn = 0;
+
+	// Words are patched in ascending order, so patched words come before unpatched ones
+	region.read(0, area, sizeof(area));
+	for (uint8_t idx = 0; idx < 32; idx++)
+	{
+		if (before[idx] == after[idx])
+		{
+			if (area[idx] != before[idx]) return false;
+			continue;
+		}
+
+		if (done && area[idx] == after[idx]) continue;
+		if (area[idx] != before[idx])
+		{
+			// Only first unpatched word can tear
+			if (!done || torn) return false;
+			torn = 1;
+		}
+		done = 0;
+	}
+
+	// Same patch list finishes interrupted job
+	region.patch(patchList, 3);
+	region.read(0, area, sizeof(area));
+
+	return !memcmp(area, patchNew, sizeof(area));
+}
+
+
+// ----- SWEEP
+static const scenario scenarios[] = {
+	{ "fifo", fifoPrepare, fifoRun, fifoCheck },
+	{ "migration", migratePrepare, migrateRun, migrateCheck },
+	{ "crash", crashPrepare, crashRun, crashCheck },
+	{ "counter32", counterPrepare<uint32_t>, counterRun<uint32_t>, counterCheck<uint32_t> },
+	{ "counter64", counterPrepare<uint64_t>, counterRun<uint64_t>, counterCheck<uint64_t> },
+	{ "ecc", eccPrepare, eccRun, eccCheckWords },
+	{ "shadow", shadowPrepare, shadowRun, shadowCheck },
+	{ "image", imagePrepare, imageRun, imageCheck },
+	{ "defaults", defaultsPrepare, defaultsRun, defaultsCheck },
+	{ "patch", patchPrepare, patchRun, patchCheck }
+};
+
+/**
+ * @brief Run scenario with power cut at operation \c op.
+ *
+ * @param sc Reference to scenario.
+ * @param op Operation number, starting from 1.
+ * @param torn Cut after operation is issued.
+ * @param seed Tear pattern seed.
+ * @param fail Reference to output invariant check result.
+ * @return \c true if power was cut.
+ */
+static bool cutAt(const scenario& sc, uint32_t op, uint8_t torn, uint8_t seed, bool& fail)
+{
+	sEEPROMHost::mount();
+	sEEPROMHost::tear = 0;
+	sEEPROMHost::strict = 1;
+	sEEPROMHost::violations = 0;
+	sc.prepare();
+
+	srand((op * 2 + torn) * TEAR_SEEDS + seed);
+	sEEPROMHost::tear = torn;
+	sEEPROM::injectFault(op, torn);
+
+	bool cut = false;
+	try
+	{
+		sc.run();
+	}
+	catch (sEEPROMHostReset&)
+	{
+		cut = true;
+	}
+
+	sEEPROM::injectFault(0, 0);
+	sEEPROMHost::tear = 0;
+
+	// PECR written while word program or erase may be in progress
+	fail = (cut && !sc.check()) || sEEPROMHost::violations;
+	return cut;
+}
+
+static result worker(uint32_t id, uint32_t workers)
+{
+	result res = { 0, 0 };
+
+	for (const scenario& sc : scenarios)
+	{
+		for (uint8_t torn = 0; torn < 2; torn++)
+		{
+			for (uint32_t op = id + 1;; op += workers)
+			{
+				bool cut = false;
+
+				// Clean cut has one outcome, torn cut is repeated with different tear patterns
+				for (uint8_t seed = 0; seed < (torn ? TEAR_SEEDS : 1); seed++)
+				{
+					bool fail;
+					if (!cutAt(sc, op, torn, seed, fail)) break;
+
+					cut = true;
+					res.cuts++;
+					if (fail)
+					{
+						res.fails++;
+						printf("%s: invariant broken at op %u%s\n", sc.name, op, torn ? " (torn)" : "");
+					}
+				}
+
+				if (!cut) break;
+			}
+		}
+	}
+
+	return res;
+}
+
+
+// ----- MAIN
+int main(void)
+{
+	if (!sEEPROMHost::mount())
+	{
+		printf("cutsweep: Cannot map EEPROM at 0x%08X!\n", SEEPROM_START);
+		return 1;
+	}
+
+	long cores = sysconf(_SC_NPROCESSORS_ONLN);
+	uint32_t workers = (cores > 0) ? cores : 1;
+	int pipes[2];
+	if (pipe(pipes)) return 1;
+
+	timespec t0;
+	timespec t1;
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+
+	// One process per core, each has its own EEPROM mapping
+	for (uint32_t id = 0; id < workers; id++)
+	{
+		if (fork()) continue;
+
+		result res = worker(id, workers);
+		fflush(stdout);
+		if (write(pipes[1], &res, sizeof(res)) != sizeof(res)) _exit(1);
+		_exit(0);
+	}
+
+	result total = { 0, 0 };
+	for (uint32_t id = 0; id < workers; id++)
+	{
+		result res;
+		if (read(pipes[0], &res, sizeof(res)) != sizeof(res)) return 1;
+
+		total.cuts += res.cuts;
+		total.fails += res.fails;
+	}
+	while (wait(nullptr) > 0);
+
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+	double sec = (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9;
+
+	printf("%u cut points, %u failed, %u workers, %.0f cuts/s\n", total.cuts, total.fails, workers, total.cuts / sec);
+
+	return total.fails ? 1 : 0;
+}
+
+// END WITH NEW LINE
@@ -0,0 +1,204 @@
+/**
+ * @file ecc.cpp
+ * @author silvio3105 (www.github.com/silvio3105)
+ * @brief SECDED check and overhead measurement of \ref sEEPROMECC on host.
+ *
+ * Every single and double bit error pattern of 39 bit codeword is applied to set of data words. Single errors must be corrected and double errors must be detected.
+ * Hsiao code is linear, so syndrome of error pattern does not depend on data word and patterns checked on one word hold for all words.
+ * Uncommitted and erased words are checked too. EEPROM programs per written word and encode and decode time are measured against plain \ref sEEPROM write.
+ *
+ * Build and run from repository root:
+ * g++ -std=c++17 -O2 -DSTM32L051xx -DSEEPROM_WEAR -Iexamples/host -I. sEEPROM.cpp examples/host/ecc.cpp -o ecc && ./ecc
+ *
+ * @copyright Copyright (c) 2023, silvio3105
+ *
+ */
+
+/*
+License
+
+Copyright (c) 2023, silvio3105 (www.github.com/silvio3105)
+
+Access and use of this Project and its contents are granted free of charge to any Person.
+The Person is allowed to copy, modify and use The Project and its contents only for non-commercial use.
+Commercial use of this Project and its contents is prohibited.
+Modifying this License and/or sublicensing is prohibited.
+
+THE PROJECT AND ITS CONTENT ARE PROVIDED "AS IS" WITH ALL FAULTS AND WITHOUT EXPRESSED OR IMPLIED WARRANTY.
+THE AUTHOR KEEPS ALL RIGHTS TO CHANGE OR REMOVE THE CONTENTS OF THIS PROJECT WITHOUT PREVIOUS NOTICE.
+THE AUTHOR IS NOT RESPONSIBLE FOR DAMAGE OF ANY KIND OR LIABILITY CAUSED BY USING THE CONTENTS OF THIS PROJECT.
+
+This License shall be included in all methodal textual files.
+*/
+
+
+// ----- INCLUDE FILES
+#include			"sEEPROM.h"
+#include			<stdio.h>
+#include			<stdlib.h>
+#include			<time.h>
+
+#ifndef SEEPROM_WEAR
+#error "ecc: Build with -DSEEPROM_WEAR!"
+#endif // SEEPROM_WEAR
+
+
+// ----- DEFINES
+#define WORDS					(SEEPROM_SIZE / 4) /**< @brief Number of EEPROM words. */
+#define DATA_WORDS				4096 /**< @brief Number of data words for error patterns. */
+#define BITS					39 /**< @brief Codeword length in bits. */
+#define TIMED_WORDS				(1 << 24) /**< @brief Number of words for encode and decode timing. */
+
+
+// ----- FUNCTIONS
+/**
+ * @brief Flip codeword bit.
+ *
+ * @param word Reference to data word.
+ * @param check Reference to check byte.
+ * @param bit Bit position, 0-31 data and 32-38 check bits.
+ * @return No return value.
+ */
+static void flip(uint32_t& word, uint8_t& check, uint8_t bit)
+{
+	if (bit < 32) word ^= 1UL << bit;
+	else check ^= 1 << (bit - 32);
+}
+
+/**
+ * @brief Get number of word programs since last call.
+ *
+ * @param wear Pointer to word cycle counters.
+ * @return Number of programs.
+ */
+static uint32_t programs(uint32_t* wear)
+{
+	uint32_t cnt = 0;
+
+	for (uint16_t word = 0; word < WORDS; word++)
+	{
+		cnt += wear[word];
+		wear[word] = 0;
+	}
+
+	return cnt;
+}
+
+static double seconds(const timespec& t0)
+{
+	timespec t1;
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+
+	return (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9;
+}
+
+
+// ----- MAIN
+int main(void)
+{
+	uint32_t fails = 0;
+	uint32_t patterns = 0;
+	srand(1);
+
+	// Single and double bit errors on data words with walking ones, all zeros, all ones and random words
+	for (uint32_t idx = 0; idx < DATA_WORDS; idx++)
+	{
+		uint32_t data = (idx < 32) ? (1UL << idx) : (idx == 32) ? 0 : (idx == 33) ? 0xFFFFFFFF : ((uint32_t)rand() << 16) ^ (uint32_t)rand();
+		uint8_t chk = SEEPROM_ECC_COMMIT | sEEPROMECC::encode(data);
+
+		for (uint8_t a = 0; a < BITS; a++)
+		{
+			uint32_t word = data;
+			uint8_t check = chk;
+
+			// Single error is corrected in data and check bits
+			flip(word, check, a);
+			if (sEEPROMECC::decode(word, check) != SEEPROM_NOK || word != data || check != chk) fails++;
+			patterns++;
+
+			for (uint8_t b = a + 1; b < BITS; b++)
+			{
+				word = data;
+				check = chk;
+
+				// Double error is detected
+				flip(word, check, a);
+				flip(word, check, b);
+				if (sEEPROMECC::decode(word, check) != SEEPROM_ECC) fails++;
+				patterns++;
+			}
+		}
+
+		// Uncommitted word is never decoded
+		uint32_t word = data;
+		uint8_t check = chk & ~SEEPROM_ECC_COMMIT;
+		if (sEEPROMECC::decode(word, check) != SEEPROM_ECC && (data || check)) fails++;
+
+		word = data;
+		check = SEEPROM_ECC_OPEN;
+		if (sEEPROMECC::decode(word, check) != SEEPROM_ECC) fails++;
+	}
+
+	// Erased word is valid
+	uint32_t erased = 0;
+	uint8_t erasedChk = 0;
+	if (sEEPROMECC::decode(erased, erasedChk) != SEEPROM_OK) fails++;
+
+	printf("%u data words, %u error patterns, %u failed\n\n", DATA_WORDS, patterns, fails);
+
+	// Encode and decode time
+	timespec t0;
+	volatile uint32_t sink = 0;
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+	for (uint32_t idx = 0; idx < TIMED_WORDS; idx++) sink = sink + sEEPROMECC::encode(idx * 2654435761UL);
+	double enc = seconds(t0);
+
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+	for (uint32_t idx = 0; idx < TIMED_WORDS; idx++)
+	{
+		uint32_t word = idx * 2654435761UL;
+		uint8_t check = SEEPROM_ECC_COMMIT | (idx & 0x7F);
+		sink = sink + sEEPROMECC::decode(word, check);
+	}
+	double dec = seconds(t0);
+
+	printf("encode %.1f ns/word, decode %.1f ns/word on host\n\n", enc * 1e9 / TIMED_WORDS, dec * 1e9 / TIMED_WORDS);
+
+	// EEPROM programs per write
+	if (!sEEPROMHost::mount())
+	{
+		printf("ecc: Cannot map EEPROM at 0x%08X!\n", SEEPROM_START);
+		return 1;
+	}
+
+	static uint32_t wear[WORDS];
+	sEEPROMWear::attach(wear);
+
+	sEEPROM plain(SEEPROM_START, 1024);
+	sEEPROM data(SEEPROM_START + 1024, 512);
+	sEEPROM check(SEEPROM_START + 1536, 128);
+	sEEPROMECC ecc(data, check);
+
+	printf("%6s %14s %14s %12s\n", "words", "plain programs", "ecc programs", "ecc overhead");
+	const uint16_t lens[] = { 1, 4, 16, 64, 128 };
+	for (uint16_t words : lens)
+	{
+		uint32_t buf[128];
+		for (uint16_t idx = 0; idx < words; idx++) buf[idx] = rand() | 1;
+
+		plain.write(0, buf, words * 4);
+		uint32_t plainCnt = programs(wear);
+
+		ecc.write(0, buf, words * 4);
+		uint32_t eccCnt = programs(wear);
+
+		printf("%6u %14u %14u %11.0f%%\n", words, plainCnt, eccCnt, 100.0 * ((double)eccCnt / plainCnt - 1.0));
+	}
+
+	printf("\ncheck area is %u%% of data area\n", 100 / 4);
+	sEEPROMWear::attach(nullptr);
+
+	return fails ? 1 : 0;
+}
+
+// END WITH NEW LINE
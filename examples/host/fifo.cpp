@@ -0,0 +1,179 @@
+/**
+ * @file fifo.cpp
+ * @author silvio3105 (www.github.com/silvio3105)
+ * @brief Persistent FIFO reference model test on host.
+ *
+ * Random push, peek, pop and popBatch operations are run against \ref sEEPROMFIFO and \c std::deque reference model.
+ * Queue object is created and mounted again before every operation, so every operation starts from state recovered from EEPROM.
+ * Entry count, entry lengths and payloads must match reference model after every operation.
+ *
+ * Build and run from repository root:
+ * g++ -std=c++17 -O2 -DSTM32L051xx -Iexamples/host -I. sEEPROM.cpp examples/host/fifo.cpp -o fifo && ./fifo 20000 3
+ *
+ * Arguments are number of operations and random seed.
+ *
+ * @copyright Copyright (c) 2023, silvio3105
+ *
+ */
+
+/*
+License
+
+Copyright (c) 2023, silvio3105 (www.github.com/silvio3105)
+
+Access and use of this Project and its contents are granted free of charge to any Person.
+The Person is allowed to copy, modify and use The Project and its contents only for non-commercial use.
+Commercial use of this Project and its contents is prohibited.
+Modifying this License and/or sublicensing is prohibited.
+
+THE PROJECT AND ITS CONTENT ARE PROVIDED "AS IS" WITH ALL FAULTS AND WITHOUT EXPRESSED OR IMPLIED WARRANTY.
+THE AUTHOR KEEPS ALL RIGHTS TO CHANGE OR REMOVE THE CONTENTS OF THIS PROJECT WITHOUT PREVIOUS NOTICE.
+THE AUTHOR IS NOT RESPONSIBLE FOR DAMAGE OF ANY KIND OR LIABILITY CAUSED BY USING THE CONTENTS OF THIS PROJECT.
+
+This License shall be included in all methodal textual files.
+*/
+
+
+// ----- INCLUDE FILES
+#include			"sEEPROM.h"
+#include			<stdio.h>
+#include			<stdlib.h>
+#include			<deque>
+#include			<vector>
+
+
+// ----- DEFINES
+#define FIFO_SIZE				512 /**< @brief Queue area size in bytes. */
+#define MAX_PAYLOAD				40 /**< @brief Maximum entry payload in bytes. */
+#define BATCH_SIZE				96 /**< @brief popBatch output size in bytes. */
+
+
+// ----- TYPEDEFS
+typedef std::vector<uint8_t> entry; /**< @brief Reference model entry. */
+
+
+// ----- VARIABLES
+static sEEPROM area(SEEPROM_START, FIFO_SIZE); /**< @brief Queue area. */
+static std::deque<entry> model; /**< @brief Reference model. */
+static uint32_t rejected = 0; /**< @brief Number of pushes rejected by full queue. */
+
+
+// ----- FUNCTIONS
+/**
+ * @brief Check popped or peeked entry against oldest reference entry.
+ *
+ * @param data Pointer to entry payload.
+ * @param len Entry length in bytes.
+ * @return \c true if entry matches.
+ */
+static bool oldest(const uint8_t* data, uint16_t len)
+{
+	return !model.empty() && len == model.front().size() && !memcmp(data, model.front().data(), len);
+}
+
+/**
+ * @brief Run one random operation.
+ *
+ * @param fifo Reference to mounted queue.
+ * @return \c true if queue behaves as reference model.
+ */
+static bool step(sEEPROMFIFO& fifo)
+{
+	uint8_t buff[BATCH_SIZE];
+	uint16_t len;
+
+	// Pushes are more likely than removes, so queue fills up and wraps
+	switch (rand() % 7)
+	{
+		case 0:
+		case 1:
+		case 2:
+		case 3:
+		{
+			entry value(rand() % (MAX_PAYLOAD + 1));
+			for (uint8_t& byte : value) byte = rand();
+
+			// Full queue rejects push, push into queue with room must succeed
+			if (fifo.push(value.data(), value.size()) == SEEPROM_OK)
+			{
+				model.push_back(value);
+				return true;
+			}
+
+			rejected++;
+			return !model.empty();
+		}
+
+		case 4:
+		{
+			if (fifo.peek(buff, sizeof(buff), len) != SEEPROM_OK) return model.empty();
+			return oldest(buff, len);
+		}
+
+		case 5:
+		{
+			if (fifo.pop(buff, sizeof(buff), len) != SEEPROM_OK) return model.empty();
+			if (!oldest(buff, len)) return false;
+
+			model.pop_front();
+			return true;
+		}
+
+		default:
+		{
+			uint16_t used;
+			uint16_t cnt = fifo.popBatch(buff, sizeof(buff), used);
+			uint16_t pos = 0;
+
+			// Each entry is length prefixed
+			for (uint16_t idx = 0; idx < cnt; idx++)
+			{
+				len = buff[pos] | (buff[pos + 1] << 8);
+				if (!oldest(buff + pos + 2, len)) return false;
+
+				model.pop_front();
+				pos += 2 + len;
+			}
+
+			// Batch stops only when next entry does not fit
+			if (pos != used) return false;
+			return model.empty() || (used + 2 + model.front().size()) > sizeof(buff);
+		}
+	}
+}
+
+
+// ----- MAIN
+int main(int argc, char** argv)
+{
+	uint32_t ops = 20000;
+	uint32_t seed = 3;
+
+	if (argc > 1) ops = atoi(argv[1]);
+	if (argc > 2) seed = atoi(argv[2]);
+
+	if (!sEEPROMHost::mount())
+	{
+		printf("fifo: Cannot map EEPROM at 0x%08X!\n", SEEPROM_START);
+		return 1;
+	}
+
+	srand(seed);
+	for (uint32_t op = 0; op < ops; op++)
+	{
+		// Queue state comes only from EEPROM
+		sEEPROMFIFO fifo(area);
+		fifo.mount();
+
+		if (fifo.count() != model.size() || !step(fifo))
+		{
+			printf("fifo: Mismatch at operation %u, %u entries in queue, %zu in model\n", op, fifo.count(), model.size());
+			return 1;
+		}
+	}
+
+	printf("%u operations, %u pushes rejected by full queue, %zu entries left, ok\n", ops, rejected, model.size());
+	return 0;
+}
+
+// END WITH NEW LINE
@@ -0,0 +1,314 @@
+/**
+ * @file fleet.cpp
+ * @author silvio3105 (www.github.com/silvio3105)
+ * @brief EEPROM lifetime projection for fleet of devices on host.
+ *
+ * Workload model runs against independent EEPROM image of every simulated device in accelerated virtual time, one process per CPU core.
+ * Word cycles are counted with \ref sEEPROMWear and per word cycle distribution and projected time to failure are reported for whole fleet.
+ * Layouts are compared by running same fleet with different layout argument.
+ *
+ * Build and run from repository root:
+ * g++ -std=c++17 -O2 -DSTM32L051xx -DSEEPROM_WEAR -Iexamples/host -I. sEEPROM.cpp examples/host/fleet.cpp -o fleet && ./fleet ring 256 1
+ *
+ * Arguments are layout(\c word or \c ring), number of devices and simulated years.
+ *
+ * @copyright Copyright (c) 2023, silvio3105
+ *
+ */
+
+/*
+License
+
+Copyright (c) 2023, silvio3105 (www.github.com/silvio3105)
+
+Access and use of this Project and its contents are granted free of charge to any Person.
+The Person is allowed to copy, modify and use The Project and its contents only for non-commercial use.
+Commercial use of this Project and its contents is prohibited.
+Modifying this License and/or sublicensing is prohibited.
+
+THE PROJECT AND ITS CONTENT ARE PROVIDED "AS IS" WITH ALL FAULTS AND WITHOUT EXPRESSED OR IMPLIED WARRANTY.
+THE AUTHOR KEEPS ALL RIGHTS TO CHANGE OR REMOVE THE CONTENTS OF THIS PROJECT WITHOUT PREVIOUS NOTICE.
+THE AUTHOR IS NOT RESPONSIBLE FOR DAMAGE OF ANY KIND OR LIABILITY CAUSED BY USING THE CONTENTS OF THIS PROJECT.
+
+This License shall be included in all methodal textual files.
+*/
+
+
+// ----- INCLUDE FILES
+#include			"sEEPROM.h"
+#include			<stdio.h>
+#include			<unistd.h>
+#include			<sys/wait.h>
+#include			<time.h>
+#include			<algorithm>
+#include			<vector>
+
+#ifndef SEEPROM_WEAR
+#error "fleet: Build with -DSEEPROM_WEAR!"
+#endif // SEEPROM_WEAR
+
+
+// ----- DEFINES
+#define WORDS					(SEEPROM_SIZE / 4) /**< @brief Number of EEPROM words. */
+#define HOURS_PER_YEAR			8760 /**< @brief Virtual time units per year. */
+#define BUCKETS					7 /**< @brief Number of cycle histogram buckets. */
+
+
+// ----- STRUCTS
+/**
+ * @brief Worker result.
+ *
+ */
+struct result {
+	uint64_t sum[WORDS]; /**< @brief Sum of word cycles over devices. */
+	uint32_t max[WORDS]; /**< @brief Most cycles of word on any device. */
+	uint32_t hist[BUCKETS]; /**< @brief Number of device words by cycles per year in decades. */
+	uint32_t devices; /**< @brief Number of simulated devices. Projected lifetime of each device in hours follows result. */
+};
+
+
+// ----- VARIABLES
+static uint8_t ring = 1; /**< @brief Hour counter uses \ref sEEPROMCounter slot ring. */
+static uint32_t hours = HOURS_PER_YEAR; /**< @brief Simulated hours per device. */
+
+
+// ----- WORKLOAD MODEL
+/**
+ * @brief Run workload model on one device.
+ *
+ * Layout: settings at 0(64 bytes), hour counter at 64(one word or 256 byte slot ring), event log FIFO at 512(1024 bytes).
+ * Every hour runtime counter is stored. Typical device changes one setting per day and logs four events per day, usage of each device is 0.25 to 4 times typical.
+ *
+ * @param id Device ID, seeds device usage.
+ * @param wear Pointer to output word cycle counters.
+ * @return Projected lifetime in hours.
+ */
+static uint32_t simulate(uint32_t id, uint32_t* wear)
+{
+	sEEPROMHost::mount();
+	sEEPROMWear::attach(wear);
+	srand(id + 1);
+
+	// Usage in percent of typical device
+	uint32_t usage = 25 + rand() % 376;
+
+	sEEPROM settings(SEEPROM_START, 64);
+	sEEPROM counter(SEEPROM_START + 64, 256);
+	sEEPROM log(SEEPROM_START + 512, 1024);
+	sEEPROMCounter<uint32_t> runtime(counter);
+	sEEPROMFIFO events(log);
+	uint8_t cfg[64] = { 0 };
+
+	runtime.mount();
+	events.mount();
+
+	for (uint32_t hour = 0; hour < hours; hour++)
+	{
+		if (ring) runtime.increment();
+		else
+		{
+			uint32_t value = hour + 1;
+			counter.write(0, &value, 4);
+		}
+
+		// Setting change
+		if ((uint32_t)(rand() % 2400) < usage)
+		{
+			uint8_t next[64];
+			memcpy(next, cfg, sizeof(cfg));
+			next[rand() % sizeof(next)] = rand();
+
+			settings.writeDiff(0, cfg, next, sizeof(next));
+			memcpy(cfg, next, sizeof(cfg));
+		}
+
+		// Event, oldest events are dropped to keep last 16
+		if ((uint32_t)(rand() % 600) < usage)
+		{
+			uint32_t event[2] = { hour, (uint32_t)rand() };
+			uint32_t out[2];
+			uint16_t len;
+
+			while (events.push(event, sizeof(event)) != SEEPROM_OK && events.pop(out, sizeof(out), len) == SEEPROM_OK);
+			if (events.count() > 16) events.pop(out, sizeof(out), len);
+		}
+	}
+
+	uint32_t ttf = sEEPROMWear::project(hours);
+	sEEPROMWear::attach(nullptr);
+
+	return (ttf > (0xFFFFFFFF - hours)) ? 0xFFFFFFFF : (hours + ttf);
+}
+
+
+// ----- FLEET
+/**
+ * @brief Transfer whole buffer over pipe.
+ *
+ * @param fd Pipe descriptor.
+ * @param data Pointer to buffer.
+ * @param len Buffer length in bytes.
+ * @param out Write if \c true, read otherwise.
+ * @return \c true if all bytes are transferred.
+ */
+static bool transfer(int fd, void* data, size_t len, bool out)
+{
+	uint8_t* ptr = (uint8_t*)data;
+
+	while (len)
+	{
+		ssize_t cnt = out ? write(fd, ptr, len) : read(fd, ptr, len);
+		if (cnt <= 0) return false;
+
+		ptr += cnt;
+		len -= cnt;
+	}
+
+	return true;
+}
+
+static void worker(uint32_t id, uint32_t workers, uint32_t devices, int fd)
+{
+	static result res;
+	static uint32_t wear[WORDS];
+	std::vector<uint32_t> life;
+
+	for (uint32_t dev = id; dev < devices; dev += workers)
+	{
+		life.push_back(simulate(dev, wear));
+
+		for (uint16_t word = 0; word < WORDS; word++)
+		{
+			res.sum[word] += wear[word];
+			if (wear[word] > res.max[word]) res.max[word] = wear[word];
+
+			// Cycles per year in decades: 0, 1-9, 10-99...
+			uint64_t perYear = ((uint64_t)wear[word] * HOURS_PER_YEAR) / hours;
+			uint8_t bucket = 0;
+			while (perYear && bucket < (BUCKETS - 1))
+			{
+				bucket++;
+				perYear /= 10;
+			}
+			res.hist[bucket]++;
+		}
+	}
+
+	res.devices = life.size();
+	if (!transfer(fd, &res, sizeof(res), true) || !transfer(fd, life.data(), life.size() * 4, true)) _exit(1);
+}
+
+
+// ----- MAIN
+int main(int argc, char** argv)
+{
+	uint32_t devices = 256;
+
+	if (argc > 1) ring = strcmp(argv[1], "word");
+	if (argc > 2) devices = atoi(argv[2]);
+	if (argc > 3) hours = atof(argv[3]) * HOURS_PER_YEAR;
+	if (!devices || !hours) return 1;
+
+	if (!sEEPROMHost::mount())
+	{
+		printf("fleet: Cannot map EEPROM at 0x%08X!\n", SEEPROM_START);
+		return 1;
+	}
+
+	long cores = sysconf(_SC_NPROCESSORS_ONLN);
+	uint32_t workers = (cores > 0) ? cores : 1;
+	if (workers > devices) workers = devices;
+
+	timespec t0;
+	timespec t1;
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+
+	// One process per core, each has its own EEPROM mapping and pipe
+	std::vector<int> pipes;
+	for (uint32_t id = 0; id < workers; id++)
+	{
+		int fds[2];
+		if (pipe(fds)) return 1;
+
+		if (!fork())
+		{
+			close(fds[0]);
+			worker(id, workers, devices, fds[1]);
+			_exit(0);
+		}
+
+		close(fds[1]);
+		pipes.push_back(fds[0]);
+	}
+
+	static result total;
+	static result res;
+	std::vector<uint32_t> life;
+
+	for (int fd : pipes)
+	{
+		if (!transfer(fd, &res, sizeof(res), false)) return 1;
+
+		for (uint16_t word = 0; word < WORDS; word++)
+		{
+			total.sum[word] += res.sum[word];
+			if (res.max[word] > total.max[word]) total.max[word] = res.max[word];
+		}
+		for (uint8_t bucket = 0; bucket < BUCKETS; bucket++) total.hist[bucket] += res.hist[bucket];
+
+		size_t at = life.size();
+		life.resize(at + res.devices);
+		if (!transfer(fd, life.data() + at, res.devices * 4, false)) return 1;
+		close(fd);
+	}
+	while (wait(nullptr) > 0);
+
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+	double sec = (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9;
+	double years = (double)hours / HOURS_PER_YEAR;
+
+	printf("layout %s, %u devices, %.2f years each, %u workers, %.0f device years/s\n\n", ring ? "ring" : "word", devices, years, workers, (devices * years) / sec);
+
+	// Per word cycle distribution
+	printf("word cycles per year   words\n");
+	for (uint8_t bucket = 0; bucket < BUCKETS; bucket++)
+	{
+		uint32_t lo = 1;
+		for (uint8_t idx = 1; idx < bucket; idx++) lo *= 10;
+
+		if (!bucket) printf("%21s", "0");
+		else if (bucket == (BUCKETS - 1)) printf("%20u+", lo);
+		else printf("%12u - %6u", lo, lo * 10 - 1);
+		printf("   %u\n", total.hist[bucket]);
+	}
+
+	// Hottest words over fleet
+	uint16_t order[WORDS];
+	for (uint16_t word = 0; word < WORDS; word++) order[word] = word;
+	std::sort(order, order + WORDS, [&](uint16_t a, uint16_t b) { return total.max[a] > total.max[b]; });
+
+	printf("\nhottest words   offset   mean/year    max/year\n");
+	for (uint8_t idx = 0; idx < 8; idx++)
+	{
+		uint16_t word = order[idx];
+		printf("%13u   %6u   %9.0f   %9.0f\n", word, word * 4, (total.sum[word] / (double)devices) / years, total.max[word] / years);
+	}
+
+	// Projected lifetime percentiles
+	std::sort(life.begin(), life.end());
+	printf("\nprojected time to failure in years(rated endurance %u cycles)\n", SEEPROM_ENDURANCE);
+
+	const uint8_t pct[] = { 0, 1, 10, 50 };
+	const char* name[] = { "min", "p1", "p10", "median" };
+	for (uint8_t idx = 0; idx < sizeof(pct); idx++)
+	{
+		uint32_t hrs = life[((size_t)pct[idx] * (life.size() - 1)) / 100];
+
+		if (hrs == 0xFFFFFFFF) printf("%8s   no wear\n", name[idx]);
+		else printf("%8s   %.1f\n", name[idx], (double)hrs / HOURS_PER_YEAR);
+	}
+
+	return 0;
+}
+
+// END WITH NEW LINE
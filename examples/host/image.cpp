@@ -0,0 +1,224 @@
+/**
+ * @file image.cpp
+ * @author silvio3105 (www.github.com/silvio3105)
+ * @brief EEPROM image build, diff and apply on host.
+ *
+ * Without arguments, images of two demo layout versions are built with \ref sEEPROMImage::build, verified and diffed into patches.
+ * New image is then written to host EEPROM holding old image with \ref sEEPROM::writeImage, which programs only changed words, and corrupted image is rejected before anything is written.
+ * With two image files(eg., dumps of device EEPROM), both are verified and their diff is printed.
+ *
+ * Build and run from repository root:
+ * g++ -std=c++17 -O2 -DSTM32L051xx -DSEEPROM_WEAR -Iexamples/host -I. sEEPROM.cpp examples/host/image.cpp -o image && ./image
+ * ./image old.bin new.bin
+ *
+ * @copyright Copyright (c) 2023, silvio3105
+ *
+ */
+
+/*
+License
+
+Copyright (c) 2023, silvio3105 (www.github.com/silvio3105)
+
+Access and use of this Project and its contents are granted free of charge to any Person.
+The Person is allowed to copy, modify and use The Project and its contents only for non-commercial use.
+Commercial use of this Project and its contents is prohibited.
+Modifying this License and/or sublicensing is prohibited.
+
+THE PROJECT AND ITS CONTENT ARE PROVIDED "AS IS" WITH ALL FAULTS AND WITHOUT EXPRESSED OR IMPLIED WARRANTY.
+THE AUTHOR KEEPS ALL RIGHTS TO CHANGE OR REMOVE THE CONTENTS OF THIS PROJECT WITHOUT PREVIOUS NOTICE.
+THE AUTHOR IS NOT RESPONSIBLE FOR DAMAGE OF ANY KIND OR LIABILITY CAUSED BY USING THE CONTENTS OF THIS PROJECT.
+
+This License shall be included in all methodal textual files.
+*/
+
+
+// ----- INCLUDE FILES
+#include			"sEEPROM.h"
+#include			<stdio.h>
+#include			<string.h>
+
+#ifndef SEEPROM_WEAR
+#error "image: Build with -DSEEPROM_WEAR!"
+#endif // SEEPROM_WEAR
+
+
+// ----- DEFINES
+#define WORDS					(SEEPROM_SIZE / 4) /**< @brief Number of EEPROM words. */
+#define MAX_PATCHES				64 /**< @brief Size of patch array. */
+
+
+// ----- VARIABLES
+static const uint32_t baud = 115200;
+static const uint8_t name[16] = "sensor-01";
+static const uint32_t interval = 60;
+static const uint16_t limits[4] = { 10, 20, 30, 40 };
+
+static const sEEPROMField fieldsV1[] = {
+	{ 1, 8, 4, &baud },
+	{ 2, 12, 16, name },
+	{ 3, 28, 4, &interval }
+};
+
+static const sEEPROMField fieldsV2[] = {
+	{ 1, 8, 4, &baud },
+	{ 2, 12, 16, name },
+	{ 3, 28, 4, &interval },
+	{ 4, 64, 8, limits }
+};
+
+static const sEEPROMSchema layoutV1 = { 1, fieldsV1, 3 };
+static const sEEPROMSchema layoutV2 = { 2, fieldsV2, 4 };
+
+
+// ----- FUNCTIONS
+/**
+ * @brief Load image file.
+ *
+ * @param path Image file path.
+ * @param image Pointer to output image with \c SEEPROM_SIZE bytes.
+ * @return Image size in bytes or \c 0 on error.
+ */
+static uint16_t load(const char* path, uint8_t* image)
+{
+	FILE* file = fopen(path, "rb");
+	if (!file) return 0;
+
+	size_t len = fread(image, 1, SEEPROM_SIZE, file);
+	fclose(file);
+
+	return len & ~0x3;
+}
+
+/**
+ * @brief Print image header check result.
+ *
+ * @param label Image label.
+ * @param image Pointer to image.
+ * @param size Image size in bytes.
+ * @return \c true if image is valid.
+ */
+static bool check(const char* label, const uint8_t* image, uint16_t size)
+{
+	uint16_t version = 0;
+	bool ok = sEEPROMImage::verify(image, size, version) == SEEPROM_OK;
+
+	if (ok) printf("%-10s %u bytes, layout version %u, CRC ok\n", label, size, version);
+	else printf("%-10s %u bytes, header or CRC is not valid\n", label, size);
+
+	return ok;
+}
+
+/**
+ * @brief Diff images and print patches.
+ *
+ * @param oldImage Pointer to current image.
+ * @param newImage Pointer to new image.
+ * @param size Image size in bytes.
+ * @return Number of patches or \c -1 if patch array is too small.
+ */
+static int diff(const uint8_t* oldImage, const uint8_t* newImage, uint16_t size)
+{
+	sEEPROMPatch patches[MAX_PATCHES];
+	uint16_t count;
+
+	if (sEEPROMImage::diff(oldImage, newImage, size, patches, MAX_PATCHES, count) != SEEPROM_OK)
+	{
+		printf("more than %u patches\n", MAX_PATCHES);
+		return -1;
+	}
+
+	uint16_t bytes = 0;
+	printf("\n%u patches\n", count);
+	for (uint16_t idx = 0; idx < count; idx++)
+	{
+		printf("  offset %4u, %3u bytes\n", patches[idx].offset, patches[idx].len);
+		bytes += patches[idx].len;
+	}
+	printf("%u of %u bytes differ\n", bytes, size);
+
+	return count;
+}
+
+static uint32_t programs(uint32_t* wear)
+{
+	uint32_t cnt = 0;
+
+	for (uint16_t word = 0; word < WORDS; word++)
+	{
+		cnt += wear[word];
+		wear[word] = 0;
+	}
+
+	return cnt;
+}
+
+
+// ----- MAIN
+int main(int argc, char** argv)
+{
+	static uint8_t oldImage[SEEPROM_SIZE];
+	static uint8_t newImage[SEEPROM_SIZE];
+
+	// Diff image files
+	if (argc > 2)
+	{
+		uint16_t oldSize = load(argv[1], oldImage);
+		uint16_t newSize = load(argv[2], newImage);
+
+		if (!oldSize || oldSize != newSize)
+		{
+			printf("image: Cannot load images or their sizes differ!\n");
+			return 1;
+		}
+
+		check("old", oldImage, oldSize);
+		check("new", newImage, newSize);
+
+		return (diff(oldImage, newImage, newSize) < 0) ? 1 : 0;
+	}
+
+	// Build and diff demo layouts
+	uint32_t newInterval = 30;
+	const void* valuesV2[] = { nullptr, nullptr, &newInterval, nullptr };
+
+	if (sEEPROMImage::build(oldImage, SEEPROM_SIZE, layoutV1) != SEEPROM_OK || sEEPROMImage::build(newImage, SEEPROM_SIZE, layoutV2, valuesV2) != SEEPROM_OK)
+	{
+		printf("image: Layout does not fit in image!\n");
+		return 1;
+	}
+
+	if (!check("v1", oldImage, SEEPROM_SIZE) || !check("v2", newImage, SEEPROM_SIZE)) return 1;
+	if (diff(oldImage, newImage, SEEPROM_SIZE) < 0) return 1;
+
+	// Apply on host EEPROM
+	if (!sEEPROMHost::mount())
+	{
+		printf("image: Cannot map EEPROM at 0x%08X!\n", SEEPROM_START);
+		return 1;
+	}
+
+	static uint32_t wear[WORDS];
+	sEEPROM eeprom(SEEPROM_START, SEEPROM_SIZE);
+	uint8_t fail = 0;
+
+	sEEPROMWear::attach(wear);
+	eeprom.writeImage(oldImage, SEEPROM_SIZE);
+	printf("\nv1 written to erased EEPROM with %u word programs\n", programs(wear));
+
+	// Corrupted image is rejected before anything is written
+	newImage[100] ^= 0x01;
+	if (eeprom.writeImage(newImage, SEEPROM_SIZE) != SEEPROM_NOK || programs(wear)) fail = 1;
+	printf("corrupted v2 %s\n", fail ? "was written!" : "rejected, nothing written");
+	newImage[100] ^= 0x01;
+
+	if (eeprom.writeImage(newImage, SEEPROM_SIZE) != SEEPROM_OK) fail = 1;
+	printf("v2 written over v1 with %u word programs\n", programs(wear));
+
+	if (memcmp((const void*)SEEPROM_START, newImage, SEEPROM_SIZE) || !check("EEPROM", (const uint8_t*)SEEPROM_START, SEEPROM_SIZE)) fail = 1;
+	sEEPROMWear::attach(nullptr);
+
+	return fail;
+}
+
+// END WITH NEW LINE
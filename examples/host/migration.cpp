@@ -0,0 +1,226 @@
+/**
+ * @file migration.cpp
+ * @author silvio3105 (www.github.com/silvio3105)
+ * @brief Layout migration power cut test on host.
+ *
+ * Each layout pair moves field 1 left, right or onto overlapping source, moves field 2 and adds field 3 with default value.
+ * Pair whose moves depend on each other in cycle must be rejected without any write.
+ * Migration is run once without cut for reference result and statistics, then once per program/erase operation with power cut before(clean) and after(torn) that operation.
+ * Torn cuts are repeated with \c TEAR_SEEDS tear patterns. After cut, migration is run again and EEPROM must match reference result.
+ *
+ * Build and run from repository root:
+ * g++ -std=c++17 -O2 -DSTM32L051xx -DSEEPROM_FAULT_INJECTION -Iexamples/host -I. sEEPROM.cpp examples/host/migration.cpp -o migration && ./migration
+ *
+ * @copyright Copyright (c) 2023, silvio3105
+ *
+ */
+
+/*
+License
+
+Copyright (c) 2023, silvio3105 (www.github.com/silvio3105)
+
+Access and use of this Project and its contents are granted free of charge to any Person.
+The Person is allowed to copy, modify and use The Project and its contents only for non-commercial use.
+Commercial use of this Project and its contents is prohibited.
+Modifying this License and/or sublicensing is prohibited.
+
+THE PROJECT AND ITS CONTENT ARE PROVIDED "AS IS" WITH ALL FAULTS AND WITHOUT EXPRESSED OR IMPLIED WARRANTY.
+THE AUTHOR KEEPS ALL RIGHTS TO CHANGE OR REMOVE THE CONTENTS OF THIS PROJECT WITHOUT PREVIOUS NOTICE.
+THE AUTHOR IS NOT RESPONSIBLE FOR DAMAGE OF ANY KIND OR LIABILITY CAUSED BY USING THE CONTENTS OF THIS PROJECT.
+
+This License shall be included in all methodal textual files.
+*/
+
+
+// ----- INCLUDE FILES
+#include			"sEEPROM.h"
+#include			<stdio.h>
+
+#ifndef SEEPROM_FAULT_INJECTION
+#error "migration: Build with -DSEEPROM_FAULT_INJECTION!"
+#endif // SEEPROM_FAULT_INJECTION
+
+
+// ----- DEFINES
+#define AREA_SIZE				256 /**< @brief Layout area size in bytes. */
+#define PROGRESS_OFFSET			200 /**< @brief Offset of migration progress words. */
+#define TEAR_SEEDS				20 /**< @brief Number of tear patterns per torn cut point. */
+
+
+// ----- STRUCTS
+/**
+ * @brief Layout pair under test.
+ *
+ */
+struct layout {
+	uint16_t from1; /**< @brief Field 1 offset in old layout. */
+	uint16_t to1; /**< @brief Field 1 offset in new layout. */
+	uint16_t to2; /**< @brief Field 2 offset in new layout. */
+	uint8_t cycle; /**< @brief Moves depend on each other in cycle. */
+};
+
+
+// ----- VARIABLES
+static const uint32_t fieldDef = 0xCAFEBABE; /**< @brief Default value of added field 3. */
+static sEEPROMField fieldsOld[] = { { 1, 4, 20, nullptr }, { 2, 40, 8, nullptr } }; /**< @brief Old layout fields. */
+static sEEPROMField fieldsNew[] = { { 1, 9, 20, nullptr }, { 2, 60, 8, nullptr }, { 3, 80, 4, &fieldDef } }; /**< @brief New layout fields. */
+static const sEEPROMSchema schemaOld = { 1, fieldsOld, 2 }; /**< @brief Old layout. */
+static const sEEPROMSchema schemaNew = { 2, fieldsNew, 3 }; /**< @brief New layout. */
+static sEEPROM area(SEEPROM_START, AREA_SIZE); /**< @brief EEPROM area with layout. */
+static uint8_t initial[AREA_SIZE]; /**< @brief EEPROM content before migration. */
+static uint8_t expect[AREA_SIZE]; /**< @brief EEPROM content after migration without cut. */
+
+static const layout layouts[] = {
+	{ 4, 9, 60, 0 }, { 8, 6, 60, 0 }, { 4, 6, 60, 0 }, { 8, 5, 60, 0 }, { 4, 5, 60, 0 }, { 12, 4, 60, 0 },
+	{ 12, 7, 60, 0 }, { 4, 27, 4, 1 }, { 4, 13, 36, 0 }, { 4, 50, 4, 0 }, { 4, 8, 44, 0 }, { 20, 4, 56, 0 }
+}; /**< @brief Layout pairs. Field 1 shifts by less than its length in most pairs, so its move overlaps own source. */
+
+
+// ----- FUNCTIONS
+/**
+ * @brief Write old layout with version 1.
+ *
+ * @return No return value.
+ */
+static void prepare(void)
+{
+	uint32_t version = 1;
+	uint8_t data[28];
+
+	sEEPROMHost::mount();
+	for (uint8_t idx = 0; idx < sizeof(data); idx++) data[idx] = idx * 13 + 1;
+
+	area.write(0, &version, 4);
+	area.write(fieldsOld[0].offset, data, 20);
+	area.write(fieldsOld[1].offset, data + 20, 8);
+	area.read(0, initial, AREA_SIZE);
+}
+
+/**
+ * @brief Check migrated EEPROM content against old content.
+ *
+ * @return \c true if fields are moved, field 3 holds default, version is 2 and progress words are cleared.
+ */
+static bool migrated(void)
+{
+	uint8_t now[AREA_SIZE];
+	uint32_t version;
+	uint32_t progress[2];
+
+	area.read(0, now, AREA_SIZE);
+	memcpy(&version, now, 4);
+	memcpy(progress, now + PROGRESS_OFFSET, sizeof(progress));
+
+	return version == 2 && !progress[0] && !progress[1] && !memcmp(now + fieldsNew[0].offset, initial + fieldsOld[0].offset, 20) &&
+		!memcmp(now + fieldsNew[1].offset, initial + fieldsOld[1].offset, 8) && !memcmp(now + fieldsNew[2].offset, &fieldDef, 4);
+}
+
+/**
+ * @brief Run power cut sweep for current layout pair.
+ *
+ * @param cuts Reference to number of tested cut points.
+ * @return \c true if every cut resumes to reference result.
+ */
+static bool sweep(uint32_t& cuts)
+{
+	cuts = 0;
+
+	for (uint8_t torn = 0; torn < 2; torn++)
+	{
+		for (uint8_t seed = 0; seed < (torn ? TEAR_SEEDS : 1); seed++)
+		{
+			for (uint32_t op = 1;; op++)
+			{
+				bool cut = false;
+
+				prepare();
+				srand(seed * 1000 + op);
+				sEEPROMHost::tear = torn;
+				sEEPROM::injectFault(op, torn);
+
+				try
+				{
+					sEEPROMMigration::migrate(area, 0, PROGRESS_OFFSET, schemaOld, schemaNew);
+				}
+				catch (sEEPROMHostReset&)
+				{
+					cut = true;
+				}
+
+				sEEPROM::injectFault(0, 0);
+				sEEPROMHost::tear = 0;
+				if (!cut) break;
+
+				// Migration after reboot resumes and ends with same content as uncut run
+				uint8_t now[AREA_SIZE];
+				cuts++;
+				if (sEEPROMMigration::migrate(area, 0, PROGRESS_OFFSET, schemaOld, schemaNew) != SEEPROM_OK) return false;
+				area.read(0, now, AREA_SIZE);
+				if (memcmp(now, expect, AREA_SIZE))
+				{
+					printf("cut at op %u%s: ", op, torn ? " (torn)" : "");
+					return false;
+				}
+			}
+		}
+	}
+
+	return true;
+}
+
+
+// ----- MAIN
+int main(void)
+{
+	if (!sEEPROMHost::mount())
+	{
+		printf("migration: Cannot map EEPROM at 0x%08X!\n", SEEPROM_START);
+		return 1;
+	}
+
+	uint8_t fail = 0;
+	printf("%6s %6s %6s %10s %8s %6s %6s %6s\n", "old 1", "new 1", "new 2", "programmed", "progress", "naive", "cuts", "check");
+
+	for (const layout& pair : layouts)
+	{
+		sEEPROMMigrationStats stats;
+		uint32_t cuts = 0;
+
+		fieldsOld[0].offset = pair.from1;
+		fieldsNew[0].offset = pair.to1;
+		fieldsNew[1].offset = pair.to2;
+
+		// Reference run without cut
+		prepare();
+		if (pair.cycle)
+		{
+			uint8_t now[AREA_SIZE];
+			uint8_t ok = sEEPROMMigration::migrate(area, 0, PROGRESS_OFFSET, schemaOld, schemaNew) == SEEPROM_NOK;
+
+			area.read(0, now, AREA_SIZE);
+			ok &= !memcmp(now, initial, AREA_SIZE);
+			if (!ok) fail = 1;
+
+			printf("%6u %6u %6u %10s %8s %6s %6s %6s\n", pair.from1, pair.to1, pair.to2, "cycle", "-", "-", "-", ok ? "ok" : "FAIL");
+			continue;
+		}
+
+		if (sEEPROMMigration::migrate(area, 0, PROGRESS_OFFSET, schemaOld, schemaNew, &stats) != SEEPROM_OK || !migrated())
+		{
+			printf("%6u %6u %6u reference migration FAIL\n", pair.from1, pair.to1, pair.to2);
+			fail = 1;
+			continue;
+		}
+		area.read(0, expect, AREA_SIZE);
+
+		bool ok = sweep(cuts);
+		if (!ok) fail = 1;
+
+		printf("%6u %6u %6u %10u %8u %6u %6u %6s\n", pair.from1, pair.to1, pair.to2, stats.programmed, stats.progress, stats.naive, cuts, ok ? "ok" : "FAIL");
+	}
+
+	return fail;
+}
+
+// END WITH NEW LINE
@@ -0,0 +1,194 @@
+/**
+ * @file replay.cpp
+ * @author silvio3105 (www.github.com/silvio3105)
+ * @brief Replay of EEPROM trace with alternative strategies on host.
+ *
+ * Trace is raw dump of \ref sEEPROMTraceEntry array from device(see \ref sEEPROMTrace). Without trace file, demo workload is run on host EEPROM and its trace is used.
+ * Trace is replayed as recorded and with each strategy, projected EEPROM busy time and wear are compared.
+ *
+ * Build and run from repository root with trace file:
+ * g++ -std=c++17 -O2 -DSEEPROM_HOST -I. sEEPROM.cpp examples/host/replay.cpp -o replay && ./replay trace.bin
+ *
+ * Build and run with demo workload:
+ * g++ -std=c++17 -O2 -DSTM32L051xx -DSEEPROM_TRACE=4096 -Iexamples/host -I. sEEPROM.cpp examples/host/replay.cpp -o replay && ./replay
+ *
+ * Trace entries mark which written words got new value, compare-before-write strategy skips the others.
+ *
+ * @copyright Copyright (c) 2023, silvio3105
+ *
+ */
+
+/*
+License
+
+Copyright (c) 2023, silvio3105 (www.github.com/silvio3105)
+
+Access and use of this Project and its contents are granted free of charge to any Person.
+The Person is allowed to copy, modify and use The Project and its contents only for non-commercial use.
+Commercial use of this Project and its contents is prohibited.
+Modifying this License and/or sublicensing is prohibited.
+
+THE PROJECT AND ITS CONTENT ARE PROVIDED "AS IS" WITH ALL FAULTS AND WITHOUT EXPRESSED OR IMPLIED WARRANTY.
+THE AUTHOR KEEPS ALL RIGHTS TO CHANGE OR REMOVE THE CONTENTS OF THIS PROJECT WITHOUT PREVIOUS NOTICE.
+THE AUTHOR IS NOT RESPONSIBLE FOR DAMAGE OF ANY KIND OR LIABILITY CAUSED BY USING THE CONTENTS OF THIS PROJECT.
+
+This License shall be included in all methodal textual files.
+*/
+
+
+// ----- INCLUDE FILES
+#include			"sEEPROM.h"
+#include			<stdio.h>
+#include			<stdlib.h>
+#include			<string.h>
+#include			<vector>
+
+
+// ----- DEFINES
+#define WORDS					512 /**< @brief Number of words in STM32L051 EEPROM. */
+
+
+// ----- FUNCTIONS
+/**
+ * @brief Load raw trace dump.
+ *
+ * @param path Trace file path.
+ * @param trace Reference to output trace.
+ * @return \c true if trace is loaded.
+ */
+static bool load(const char* path, std::vector<sEEPROMTraceEntry>& trace)
+{
+	FILE* file = fopen(path, "rb");
+	if (!file) return false;
+
+	sEEPROMTraceEntry entry;
+	while (fread(&entry, sizeof(entry), 1, file) == 1) trace.push_back(entry);
+	fclose(file);
+
+	return !trace.empty();
+}
+
+#ifdef SEEPROM_TRACE
+/**
+ * @brief Run demo workload and collect its trace.
+ *
+ * Settings are read on boot and rewritten as whole block on every change, runtime counter is read and written every period and log header is rewritten with each entry.
+ *
+ * @param trace Reference to output trace.
+ * @return No return value.
+ */
+static void record(std::vector<sEEPROMTraceEntry>& trace)
+{
+	sEEPROMHost::mount();
+	sEEPROMTrace::clear();
+
+	sEEPROM eeprom(SEEPROM_START, SEEPROM_SIZE);
+	uint8_t settings[64] = { 0 };
+	uint32_t header[2] = { 0 };
+	srand(1);
+
+	for (uint16_t period = 0; period < 1000 && sEEPROMTrace::count() < SEEPROM_TRACE; period++)
+	{
+		uint32_t runtime;
+
+		if (!(period % 100)) eeprom.read(0, settings, sizeof(settings));
+		if (!(rand() % 8))
+		{
+			settings[rand() % sizeof(settings)]++;
+			eeprom.write(0, settings, sizeof(settings));
+		}
+
+		eeprom.read(64, &runtime, 4);
+		runtime++;
+		eeprom.write(64, &runtime, 4);
+
+		if (!(period % 4))
+		{
+			uint32_t entry[4] = { period, runtime, (uint32_t)rand(), 0 };
+
+			eeprom.read(128, header, sizeof(header));
+			eeprom.write(136 + (header[0] % 64) * 16, entry, sizeof(entry));
+			header[0]++;
+			eeprom.write(128, header, sizeof(header));
+		}
+
+		// Clear first 256 bytes of log every 250 periods
+		if (period && !(period % 250)) eeprom.erase(136, 64);
+	}
+
+	sEEPROMTraceEntry entry;
+	for (uint16_t idx = 0; sEEPROMTrace::get(idx, entry) == SEEPROM_OK; idx++) trace.push_back(entry);
+}
+#endif // SEEPROM_TRACE
+
+
+// ----- MAIN
+int main(int argc, char** argv)
+{
+	std::vector<sEEPROMTraceEntry> trace;
+
+	if (argc > 1 && strcmp(argv[1], "-"))
+	{
+		if (!load(argv[1], trace))
+		{
+			printf("replay: Cannot load trace %s!\n", argv[1]);
+			return 1;
+		}
+	}
+	else
+	{
+		#ifdef SEEPROM_TRACE
+		if (!sEEPROMHost::mount())
+		{
+			printf("replay: Cannot map EEPROM at 0x%08X!\n", SEEPROM_START);
+			return 1;
+		}
+
+		record(trace);
+		#else
+		printf("replay: Build with -DSTM32L051xx -DSEEPROM_TRACE=<entries> for demo workload or pass trace file!\n");
+		return 1;
+		#endif // SEEPROM_TRACE
+	}
+
+	struct {
+		const char* name;
+		uint8_t strategy;
+	} const runs[] = {
+		{ "as recorded", 0 },
+		{ "cache", SEEPROM_REPLAY_CACHE },
+		{ "coalesce", SEEPROM_REPLAY_COALESCE },
+		{ "compare", SEEPROM_REPLAY_COMPARE },
+		{ "cache+compare", SEEPROM_REPLAY_CACHE | SEEPROM_REPLAY_COMPARE },
+		{ "all", SEEPROM_REPLAY_CACHE | SEEPROM_REPLAY_COALESCE | SEEPROM_REPLAY_COMPARE }
+	};
+
+	static sEEPROMReplayWord words[WORDS];
+	sEEPROMReplayConfig config;
+	sEEPROMReplayStats base;
+	printf("%zu trace entries, flush every %u entries\n\n", trace.size(), config.flush);
+	printf("%-14s %8s %8s %10s %12s %10s %8s %8s\n", "strategy", "reads", "programs", "busy ms", "blocking ms", "hot cycles", "time", "wear");
+
+	for (const auto& run : runs)
+	{
+		sEEPROMReplayStats stats;
+		config.strategy = run.strategy;
+
+		if (sEEPROMReplay::run(trace.data(), trace.size(), config, words, stats) != SEEPROM_OK)
+		{
+			printf("replay: Trace entry goes outside EEPROM!\n");
+			return 1;
+		}
+		if (!run.strategy) base = stats;
+
+		// Savings against trace replayed as recorded
+		double time = base.us ? 100.0 * (1.0 - (double)stats.us / base.us) : 0;
+		double wear = base.cycles ? 100.0 * (1.0 - (double)stats.cycles / base.cycles) : 0;
+
+		printf("%-14s %8u %8u %10.1f %12.1f %10u %7.1f%% %7.1f%%\n", run.name, stats.reads, stats.programs, stats.us / 1000.0, stats.blocking / 1000.0, stats.cycles, time, wear);
+	}
+
+	return 0;
+}
+
+// END WITH NEW LINE
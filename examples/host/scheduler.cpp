@@ -0,0 +1,208 @@
+/**
+ * @file scheduler.cpp
+ * @author silvio3105 (www.github.com/silvio3105)
+ * @brief \ref sEEPROMScheduler latency measurement on host.
+ *
+ * Background writes of settings blocks and urgent crash records are submitted in virtual time and scheduler runs one word program at a time, each word program advances virtual time by \c SEEPROM_PROG_TIME_US.
+ * Same arrivals are run with urgent records in their own higher priority lane and with all writes in one lane. Per lane statistics from \ref sEEPROMScheduler::stats and latency of each write kind are reported.
+ *
+ * Build and run from repository root:
+ * g++ -std=c++17 -O2 -DSTM32L051xx -DSEEPROM_TIMESTAMP=sEEPROMHostTicks -Iexamples/host -I. sEEPROM.cpp examples/host/scheduler.cpp -o scheduler && ./scheduler 60
+ *
+ * Argument is virtual run time in seconds.
+ *
+ * @copyright Copyright (c) 2023, silvio3105
+ *
+ */
+
+/*
+License
+
+Copyright (c) 2023, silvio3105 (www.github.com/silvio3105)
+
+Access and use of this Project and its contents are granted free of charge to any Person.
+The Person is allowed to copy, modify and use The Project and its contents only for non-commercial use.
+Commercial use of this Project and its contents is prohibited.
+Modifying this License and/or sublicensing is prohibited.
+
+THE PROJECT AND ITS CONTENT ARE PROVIDED "AS IS" WITH ALL FAULTS AND WITHOUT EXPRESSED OR IMPLIED WARRANTY.
+THE AUTHOR KEEPS ALL RIGHTS TO CHANGE OR REMOVE THE CONTENTS OF THIS PROJECT WITHOUT PREVIOUS NOTICE.
+THE AUTHOR IS NOT RESPONSIBLE FOR DAMAGE OF ANY KIND OR LIABILITY CAUSED BY USING THE CONTENTS OF THIS PROJECT.
+
+This License shall be included in all methodal textual files.
+*/
+
+
+// ----- INCLUDE FILES
+#include			"sEEPROM.h"
+#include			<stdio.h>
+#include			<stdlib.h>
+#include			<deque>
+
+#ifndef SEEPROM_TIMESTAMP
+#error "scheduler: Build with -DSEEPROM_TIMESTAMP=sEEPROMHostTicks!"
+#endif // SEEPROM_TIMESTAMP
+
+
+// ----- DEFINES
+#define SLOTS					16 /**< @brief Scheduler slots per lane. */
+#define BACKGROUND_LEN			256 /**< @brief Background write length in bytes. */
+#define BACKGROUND_PERIOD_US	300000 /**< @brief Background write period in microseconds. */
+#define URGENT_LEN				32 /**< @brief Urgent record length in bytes. */
+#define URGENT_MEAN_US			500000 /**< @brief Mean time between urgent records in microseconds. */
+
+
+// ----- STRUCTS
+/**
+ * @brief Latency of one write kind.
+ *
+ */
+struct latency {
+	uint32_t done = 0; /**< @brief Number of finished writes. */
+	uint64_t sum = 0; /**< @brief Sum of submit to finish latencies in microseconds. */
+	uint32_t max = 0; /**< @brief Longest submit to finish latency in microseconds. */
+};
+
+/**
+ * @brief Submitted write waiting in lane.
+ *
+ */
+struct submitted {
+	uint8_t urgent; /**< @brief Write is urgent record. */
+	uint32_t at; /**< @brief Submit time in microseconds. */
+};
+
+
+// ----- FUNCTIONS
+/**
+ * @brief Run workload.
+ *
+ * @param duration Virtual run time in microseconds.
+ * @param urgentPrio Lane of urgent records.
+ * @param kinds Pointer to output latencies, background at index 0 and urgent at index 1.
+ * @return No return value.
+ */
+static void simulate(uint32_t duration, uint8_t urgentPrio, latency* kinds)
+{
+	static sEEPROMScheduler<SLOTS> sched;
+	static uint8_t background[SLOTS][BACKGROUND_LEN];
+	static uint8_t urgent[SLOTS][URGENT_LEN];
+
+	sEEPROMHost::mount();
+	sEEPROMHost::ticks = 0;
+	sched = sEEPROMScheduler<SLOTS>();
+	srand(1);
+
+	sEEPROM settings(SEEPROM_START, 1024);
+	sEEPROM crash(SEEPROM_START + 1024, 1024);
+	std::deque<submitted> lanes[SEEPROM_PRIO_COUNT];
+	uint32_t done[SEEPROM_PRIO_COUNT] = { 0 };
+	uint32_t nextBackground = 0;
+	uint32_t nextUrgent = rand() % (2 * URGENT_MEAN_US);
+	uint16_t bgCnt = 0;
+	uint16_t urCnt = 0;
+
+	while (sEEPROMHost::ticks < duration || sched.pending())
+	{
+		uint32_t now = sEEPROMHost::ticks;
+
+		// Submit arrivals which are due, latency of write kind is counted from arrival
+		while (nextBackground <= now && nextBackground < duration)
+		{
+			uint8_t* buf = background[bgCnt % SLOTS];
+			for (uint16_t idx = 0; idx < BACKGROUND_LEN; idx++) buf[idx] = rand() | 1;
+
+			if (sched.submit(1, &settings, (bgCnt % 4) * BACKGROUND_LEN, buf, BACKGROUND_LEN) == SEEPROM_OK)
+			{
+				lanes[1].push_back({ 0, nextBackground });
+				bgCnt++;
+			}
+			nextBackground += BACKGROUND_PERIOD_US;
+		}
+
+		while (nextUrgent <= now && nextUrgent < duration)
+		{
+			uint8_t* buf = urgent[urCnt % SLOTS];
+			for (uint16_t idx = 0; idx < URGENT_LEN; idx++) buf[idx] = rand() | 1;
+
+			if (sched.submit(urgentPrio, &crash, (urCnt % 32) * URGENT_LEN, buf, URGENT_LEN) == SEEPROM_OK)
+			{
+				lanes[urgentPrio].push_back({ 1, nextUrgent });
+				urCnt++;
+			}
+			nextUrgent += 1 + rand() % (2 * URGENT_MEAN_US);
+		}
+
+		// Idle until next arrival
+		if (!sched.pending())
+		{
+			uint32_t next = (nextBackground < nextUrgent) ? nextBackground : nextUrgent;
+			if (next >= duration) break;
+
+			sEEPROMHost::ticks = next;
+			continue;
+		}
+
+		// One word program
+		sched.run(1);
+		sEEPROMHost::ticks += SEEPROM_PROG_TIME_US;
+
+		// Lanes finish writes in submit order
+		for (uint8_t prio = 0; prio < SEEPROM_PRIO_COUNT; prio++)
+		{
+			while (done[prio] < sched.stats(prio).done)
+			{
+				submitted s = lanes[prio].front();
+				lanes[prio].pop_front();
+				done[prio]++;
+
+				latency& k = kinds[s.urgent];
+				uint32_t us = sEEPROMHost::ticks - s.at;
+				k.done++;
+				k.sum += us;
+				if (us > k.max) k.max = us;
+			}
+		}
+	}
+
+	printf("%-9s %6s %12s %12s %13s\n", "lane", "writes", "mean wait ms", "max wait ms", "max total ms");
+	for (uint8_t prio = 0; prio < SEEPROM_PRIO_COUNT; prio++)
+	{
+		const sEEPROMLaneStats& st = sched.stats(prio);
+		printf("%-9u %6u %12.1f %12.1f %13.1f\n", prio, st.done, st.done ? st.waitSum / 1000.0 / st.done : 0, st.waitMax / 1000.0, st.totalMax / 1000.0);
+	}
+}
+
+
+// ----- MAIN
+int main(int argc, char** argv)
+{
+	uint32_t seconds = 60;
+	if (argc > 1) seconds = atoi(argv[1]);
+	if (!seconds || seconds > 4000) return 1;
+
+	if (!sEEPROMHost::mount())
+	{
+		printf("scheduler: Cannot map EEPROM at 0x%08X!\n", SEEPROM_START);
+		return 1;
+	}
+
+	printf("%u s virtual time, %u byte background write every %u ms, %u byte urgent record every %u ms on average, %u us per word program\n", seconds, BACKGROUND_LEN, BACKGROUND_PERIOD_US / 1000, URGENT_LEN, URGENT_MEAN_US / 1000, SEEPROM_PROG_TIME_US);
+
+	const char* names[] = { "urgent in own lane 0", "all writes in lane 1" };
+	for (uint8_t mode = 0; mode < 2; mode++)
+	{
+		latency kinds[2];
+
+		printf("\n%s\n", names[mode]);
+		simulate(seconds * 1000000UL, mode ? 1 : 0, kinds);
+
+		printf("\n%-9s %6s %17s %16s\n", "kind", "writes", "mean total ms", "max total ms");
+		const char* kind[] = { "settings", "urgent" };
+		for (uint8_t idx = 0; idx < 2; idx++) printf("%-9s %6u %17.1f %16.1f\n", kind[idx], kinds[idx].done, kinds[idx].done ? kinds[idx].sum / 1000.0 / kinds[idx].done : 0, kinds[idx].max / 1000.0);
+	}
+
+	return 0;
+}
+
+// END WITH NEW LINE
@@ -0,0 +1,261 @@
+/**
+ * @file stm32l051xx.h
+ * @author silvio3105 (www.github.com/silvio3105)
+ * @brief Host stand-in for STM32L051 device header.
+ *
+ * @copyright Copyright (c) 2023, silvio3105
+ *
+ */
+
+/*
+License
+
+Copyright (c) 2023, silvio3105 (www.github.com/silvio3105)
+
+Access and use of this Project and its contents are granted free of charge to any Person.
+The Person is allowed to copy, modify and use The Project and its contents only for non-commercial use.
+Commercial use of this Project and its contents is prohibited.
+Modifying this License and/or sublicensing is prohibited.
+
+THE PROJECT AND ITS CONTENT ARE PROVIDED "AS IS" WITH ALL FAULTS AND WITHOUT EXPRESSED OR IMPLIED WARRANTY.
+THE AUTHOR KEEPS ALL RIGHTS TO CHANGE OR REMOVE THE CONTENTS OF THIS PROJECT WITHOUT PREVIOUS NOTICE.
+THE AUTHOR IS NOT RESPONSIBLE FOR DAMAGE OF ANY KIND OR LIABILITY CAUSED BY USING THE CONTENTS OF THIS PROJECT.
+
+This License shall be included in all methodal textual files.
+*/
+
+#ifndef _STM32L051XX_HOST_H_
+#define _STM32L051XX_HOST_H_
+
+/*
+Only parts of device header used by sEEPROM are provided. Data EEPROM is anonymous memory mapped at its real address(see sEEPROMHost::mount),
+so driver code runs unchanged. Program and erase complete immediately and BSY flag is never set.
+
+While torn power cut or strict check is armed, every read of FLASH->SR takes snapshot of EEPROM. Driver reads SR before each word program, so on torn power cut(see sEEPROM::injectFault)
+word which differs from snapshot is the word being programmed and it is torn: each byte is left old, erased or new.
+With strict check, PECR write is counted as violation if EEPROM changed since last SR read, because BSY was not polled after last program or erase.
+NVIC_SystemReset throws sEEPROMHostReset, harness catches it and mounts driver objects again to emulate reboot.
+*/
+
+// ----- INCLUDE FILES
+#include			<stdint.h>
+#include			<stddef.h>
+#include			<string.h>
+#include			<stdlib.h>
+#include			<sys/mman.h>
+#include			<mutex>
+
+
+// ----- DEFINES
+#define HOST_EEPROM_START		0x08080000 /**< @brief Data EEPROM start address. */
+#define HOST_EEPROM_SIZE		2048 /**< @brief Data EEPROM size in bytes. */
+
+#define FLASH_SR_BSY			(1U << 0)
+#define FLASH_SR_EOP			(1U << 1)
+#define FLASH_PECR_PELOCK		(1U << 0)
+#define FLASH_PECR_DATA			(1U << 4)
+#define FLASH_PECR_ERASE		(1U << 9)
+#define FLASH_PECR_EOPIE		(1U << 16)
+#define SysTick_LOAD_RELOAD_Msk	0xFFFFFFUL
+
+#define FLASH					(&sEEPROMHost::flash)
+#define SysTick					(&sEEPROMHost::sysTick)
+
+
+// ----- STRUCTS
+/**
+ * @brief Thrown by \c NVIC_SystemReset to emulate reboot.
+ *
+ */
+struct sEEPROMHostReset {};
+
+/**
+ * @brief FLASH status register. Read takes EEPROM snapshot for torn word emulation.
+ *
+ */
+struct sEEPROMHostSR {
+	volatile uint32_t value = 0; /**< @brief Register value. */
+
+	inline operator uint32_t();
+	inline sEEPROMHostSR& operator=(uint32_t v)
+	{
+		value = v;
+		return *this;
+	}
+};
+
+/**
+ * @brief FLASH PECR register. Write while word program or erase may be in progress is counted as violation.
+ *
+ */
+struct sEEPROMHostPECR {
+	volatile uint32_t value = 0; /**< @brief Register value. */
+
+	inline operator uint32_t() const
+	{
+		return value;
+	}
+
+	inline sEEPROMHostPECR& operator=(uint32_t v);
+
+	inline sEEPROMHostPECR& operator|=(uint32_t v)
+	{
+		return *this = value | v;
+	}
+
+	inline sEEPROMHostPECR& operator&=(uint32_t v)
+	{
+		return *this = value & v;
+	}
+};
+
+/**
+ * @brief FLASH peripheral registers.
+ *
+ */
+struct FLASH_TypeDef {
+	volatile uint32_t ACR;
+	sEEPROMHostPECR PECR;
+	volatile uint32_t PDKEYR, PEKEYR, PRGKEYR, OPTKEYR;
+	sEEPROMHostSR SR;
+	volatile uint32_t OBR, WRPR;
+};
+
+/**
+ * @brief SysTick registers.
+ *
+ */
+struct SysTick_Type {
+	volatile uint32_t CTRL, LOAD, VAL, CALIB;
+};
+
+
+// ----- CLASSES
+/**
+ * @brief Host peripheral state.
+ *
+ */
+class sEEPROMHost {
+	// PUBLIC STUFF
+	public:
+	// STATIC VARIABLES
+	static inline FLASH_TypeDef flash; /**< @brief FLASH peripheral. */
+	static inline SysTick_Type sysTick; /**< @brief SysTick peripheral. */
+	static inline thread_local uint32_t primask = 0; /**< @brief Interrupt mask of calling thread. */
+	static inline std::mutex cpu; /**< @brief Held by thread which masks interrupts, host threads model tasks of single core MCU. */
+	static inline uint8_t* eeprom = nullptr; /**< @brief Mapped data EEPROM. */
+	static inline uint8_t snapshot[HOST_EEPROM_SIZE]; /**< @brief EEPROM content at last SR read. */
+	static inline uint8_t tear = 0; /**< @brief Tear word on next reset. */
+	static inline uint8_t strict = 0; /**< @brief Check that BSY is polled after last program or erase before PECR is written. */
+	static inline uint32_t violations = 0; /**< @brief Number of PECR writes while program or erase may be in progress. */
+	static inline uint32_t ticks = 0; /**< @brief Virtual time in microseconds, advanced by host program. See \ref sEEPROMHostTicks. */
+
+	// STATIC METHOD DECLARATIONS
+	/**
+	 * @brief Map data EEPROM at its device address and erase it.
+	 *
+	 * @return \c true if EEPROM is mapped.
+	 */
+	static inline bool mount(void)
+	{
+		if (!eeprom)
+		{
+			void* mem = mmap((void*)HOST_EEPROM_START, HOST_EEPROM_SIZE, PROT_READ | PROT_WRITE, MAP_FIXED | MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+			if (mem != (void*)HOST_EEPROM_START) return false;
+			eeprom = (uint8_t*)mem;
+		}
+
+		memset(eeprom, 0x00, HOST_EEPROM_SIZE);
+		memset(snapshot, 0x00, HOST_EEPROM_SIZE);
+		flash.PECR.value = FLASH_PECR_PELOCK;
+		unmask();
+
+		return true;
+	}
+
+	/**
+	 * @brief Mask interrupts. Other threads stop at their next interrupt mask until \ref unmask is called.
+	 *
+	 * @return No return value.
+	 */
+	static inline void mask(void)
+	{
+		if (primask) return;
+
+		cpu.lock();
+		primask = 1;
+	}
+
+	/**
+	 * @brief Unmask interrupts.
+	 *
+	 * @return No return value.
+	 */
+	static inline void unmask(void)
+	{
+		if (!primask) return;
+
+		primask = 0;
+		cpu.unlock();
+	}
+
+	/**
+	 * @brief Emulate power cut.
+	 *
+	 * @return No return value.
+	 */
+	[[noreturn]] static inline void reset(void)
+	{
+		// Tear word which is being programmed
+		if (tear)
+		{
+			for (uint16_t idx = 0; idx < HOST_EEPROM_SIZE; idx++)
+			{
+				if (eeprom[idx] == snapshot[idx]) continue;
+
+				switch (rand() % 3)
+				{
+					case 0: eeprom[idx] = snapshot[idx]; break;
+					case 1: eeprom[idx] = 0x00; break;
+					default: break;
+				}
+			}
+		}
+
+		flash.PECR.value = FLASH_PECR_PELOCK;
+		unmask();
+
+		throw sEEPROMHostReset();
+	}
+};
+
+inline sEEPROMHostSR::operator uint32_t()
+{
+	if (sEEPROMHost::eeprom && (sEEPROMHost::tear || sEEPROMHost::strict)) memcpy(sEEPROMHost::snapshot, sEEPROMHost::eeprom, HOST_EEPROM_SIZE);
+	return value;
+}
+
+inline sEEPROMHostPECR& sEEPROMHostPECR::operator=(uint32_t v)
+{
+	// EEPROM changed after last SR read, so BSY was not polled after last program or erase
+	if (sEEPROMHost::eeprom && sEEPROMHost::strict && memcmp(sEEPROMHost::snapshot, sEEPROMHost::eeprom, HOST_EEPROM_SIZE)) sEEPROMHost::violations++;
+
+	value = v;
+	return *this;
+}
+
+
+// ----- FUNCTIONS
+inline void __WFI(void) {}
+inline void __DMB(void) { __sync_synchronize(); }
+inline void __DSB(void) { __sync_synchronize(); }
+inline uint32_t __get_PRIMASK(void) { return sEEPROMHost::primask; }
+inline void __set_PRIMASK(uint32_t mask) { if (mask) sEEPROMHost::mask(); else sEEPROMHost::unmask(); }
+inline void __disable_irq(void) { sEEPROMHost::mask(); }
+inline void __enable_irq(void) { sEEPROMHost::unmask(); }
+inline void NVIC_SystemReset(void) { sEEPROMHost::reset(); }
+inline uint32_t sEEPROMHostTicks(void) { return sEEPROMHost::ticks; } // Build with -DSEEPROM_TIMESTAMP=sEEPROMHostTicks for virtual time
+
+#endif // _STM32L051XX_HOST_H_
+
+// END WITH NEW LINE
@@ -0,0 +1,8 @@
+/**
+ * @file system_stm32l0xx.h
+ * @author silvio3105 (www.github.com/silvio3105)
+ * @brief Host stand-in for STM32L0 system header. sEEPROM does not use anything from it.
+ * 
+ * @copyright Copyright (c) 2023, silvio3105
+ * 
+ */
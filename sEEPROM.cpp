@@ -28,13 +28,346 @@ This License shall be included in all methodal textual files.
 // ----- INCLUDE FILES
 #include			"sEEPROM.h"
 
+
+// ----- sEEPROMCRC METHOD DEFINITIONS
+uint32_t sEEPROMCRC::update(uint32_t crc, const void* data, uint16_t len)
+{
+	static const uint32_t table[16] = {
+		0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC, 0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+		0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C, 0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C
+	};
+
+	for (uint16_t idx = 0; idx < len; idx++)
+	{
+		// Process byte in two nibbles
+		crc ^= ((const uint8_t*)data)[idx];
+		crc = (crc >> 4) ^ table[crc & 0xF];
+		crc = (crc >> 4) ^ table[crc & 0xF];
+	}
+
+	return crc;
+}
+
+uint32_t sEEPROMCRC::shift(uint32_t crc, uint32_t len)
+{
+	// x^8 in reflected form
+	uint32_t power = 1UL << 23;
+
+	// Square and multiply x^(8 * len)
+	while (len)
+	{
+		if (len & 0x1) crc = multiply(power, crc);
+
+		len >>= 1;
+		if (len) power = multiply(power, power);
+	}
+
+	return crc;
+}
+
+uint32_t sEEPROMCRC::multiply(uint32_t a, uint32_t b)
+{
+	uint32_t product = 0;
+
+	for (uint32_t mask = 1UL << 31; mask && a; mask >>= 1)
+	{
+		if (a & mask)
+		{
+			product ^= b;
+			a ^= mask;
+		}
+
+		// Multiply b by x
+		b = (b & 0x1) ? ((b >> 1) ^ 0xEDB88320) : (b >> 1);
+	}
+
+	return product;
+}
+
+
+// ----- sEEPROMImage METHOD DEFINITIONS
+uint8_t sEEPROMImage::build(uint8_t* image, uint16_t size, const sEEPROMSchema& layout, const void* const* values)
+{
+	if (size < SEEPROM_IMAGE_HEADER) return SEEPROM_OF;
+
+	// Erased image
+	for (uint16_t idx = 0; idx < size; idx++) image[idx] = 0x00;
+
+	for (uint8_t idx = 0; idx < layout.count; idx++)
+	{
+		const sEEPROMField& field = layout.fields[idx];
+		if (field.offset < SEEPROM_IMAGE_HEADER || ((uint32_t)field.offset + field.len) > size) return SEEPROM_OF;
+
+		const uint8_t* src = (const uint8_t*)((values && values[idx]) ? values[idx] : field.def);
+		if (!src) continue;
+
+		for (uint16_t pos = 0; pos < field.len; pos++) image[field.offset + pos] = src[pos];
+	}
+
+	// Header and CRC in little endian
+	uint32_t hdr[2] = { ((uint32_t)SEEPROM_IMAGE_MAGIC << 16) | layout.version, sEEPROMCRC::crc32(image + SEEPROM_IMAGE_HEADER, size - SEEPROM_IMAGE_HEADER) };
+	for (uint8_t pos = 0; pos < SEEPROM_IMAGE_HEADER; pos++) image[pos] = hdr[pos / 4] >> ((pos % 4) * 8);
+
+	return SEEPROM_OK;
+}
+
+uint8_t sEEPROMImage::verify(const uint8_t* image, uint16_t size, uint16_t& version)
+{
+	if (size < SEEPROM_IMAGE_HEADER) return SEEPROM_NOK;
+
+	uint32_t hdr[2] = { 0, 0 };
+	for (uint8_t pos = 0; pos < SEEPROM_IMAGE_HEADER; pos++) hdr[pos / 4] |= (uint32_t)image[pos] << ((pos % 4) * 8);
+
+	if ((hdr[0] >> 16) != SEEPROM_IMAGE_MAGIC) return SEEPROM_NOK;
+	if (hdr[1] != sEEPROMCRC::crc32(image + SEEPROM_IMAGE_HEADER, size - SEEPROM_IMAGE_HEADER)) return SEEPROM_NOK;
+
+	version = hdr[0] & 0xFFFF;
+	return SEEPROM_OK;
+}
+
+uint8_t sEEPROMImage::diff(const uint8_t* oldImage, const uint8_t* newImage, uint16_t size, sEEPROMPatch* patches, uint16_t max, uint16_t& count)
+{
+	count = 0;
+
+	for (uint16_t offset = 0; (offset + 4) <= size; offset += 4)
+	{
+		uint8_t same = 1;
+		for (uint8_t pos = 0; pos < 4; pos++) same &= (oldImage[offset + pos] == newImage[offset + pos]);
+		if (same) continue;
+
+		// Extend previous patch if it ends at this word
+		if (count && (patches[count - 1].offset + patches[count - 1].len) == offset)
+		{
+			patches[count - 1].len += 4;
+			continue;
+		}
+
+		if (count == max) return SEEPROM_OF;
+
+		patches[count].offset = offset;
+		patches[count].len = 4;
+		patches[count].data = newImage + offset;
+		count++;
+	}
+
+	return SEEPROM_OK;
+}
+
+
+// ----- sEEPROMReplay METHOD DEFINITIONS
+uint8_t sEEPROMReplay::run(const sEEPROMTraceEntry* trace, uint32_t count, const sEEPROMReplayConfig& config, sEEPROMReplayWord* words, sEEPROMReplayStats& stats)
+{
+	stats = sEEPROMReplayStats();
+
+	// Content before trace is unknown
+	for (uint16_t word = 0; word < (config.size / 4); word++)
+	{
+		words[word].cycles = 0;
+		words[word].state = 0;
+	}
+
+	for (uint32_t seq = 0; seq < count; seq++)
+	{
+		const sEEPROMTraceEntry& entry = trace[seq];
+		uint8_t op = entry.info >> 24;
+		uint32_t us = 0;
+
+		if (((uint32_t)entry.addr + entry.len) > config.size) return SEEPROM_OF;
+		stats.ticks += entry.info & 0xFFFFFF;
+
+		// Group size of changed word bits
+		uint8_t sh = sEEPROMTraceEntry::shift((entry.addr % 4 + entry.len + 3) / 4);
+
+		for (uint16_t word = entry.addr / 4; word < ((uint32_t)entry.addr + entry.len + 3) / 4; word++)
+		{
+			sEEPROMReplayWord& w = words[word];
+
+			if (op == SEEPROM_OP_READ)
+			{
+				// Word value is in RAM
+				if ((w.state & SEEPROM_REPLAY_DIRTY) || ((config.strategy & SEEPROM_REPLAY_CACHE) && (w.state & SEEPROM_REPLAY_CACHED))) continue;
+
+				stats.reads++;
+				us += config.readUs;
+				if (config.strategy & SEEPROM_REPLAY_CACHE) w.state |= SEEPROM_REPLAY_CACHED;
+			}
+			else if (op == SEEPROM_OP_WRITE || op == SEEPROM_OP_ERASE)
+			{
+				uint8_t changed = (entry.changed >> ((word - entry.addr / 4) >> sh)) & 0x1;
+
+				if (!(config.strategy & SEEPROM_REPLAY_COALESCE))
+				{
+					us += program(config, words, word, op == SEEPROM_OP_ERASE, changed, stats);
+					continue;
+				}
+
+				// Hold word until next flush, last value wins and word stays changed if any held write changed it
+				w.state |= SEEPROM_REPLAY_DIRTY;
+				if (changed) w.state |= SEEPROM_REPLAY_CHANGED;
+				if (op == SEEPROM_OP_ERASE) w.state |= SEEPROM_REPLAY_PENDING;
+				else w.state &= ~SEEPROM_REPLAY_PENDING;
+			}
+		}
+
+		stats.us += us;
+		if (us > stats.blocking) stats.blocking = us;
+
+		if ((config.strategy & SEEPROM_REPLAY_COALESCE) && config.flush && !((seq + 1) % config.flush))
+		{
+			us = flush(config, words, stats);
+			stats.us += us;
+			if (us > stats.blocking) stats.blocking = us;
+		}
+	}
+
+	// Program words held at trace end
+	uint32_t us = flush(config, words, stats);
+	stats.us += us;
+	if (us > stats.blocking) stats.blocking = us;
+
+	for (uint16_t word = 0; word < (config.size / 4); word++)
+	{
+		if (words[word].cycles <= stats.cycles) continue;
+
+		stats.cycles = words[word].cycles;
+		stats.hottest = word;
+	}
+
+	return SEEPROM_OK;
+}
+
+uint32_t sEEPROMReplay::program(const sEEPROMReplayConfig& config, sEEPROMReplayWord* words, uint16_t word, uint8_t erase, uint8_t changed, sEEPROMReplayStats& stats)
+{
+	sEEPROMReplayWord& w = words[word];
+	uint32_t us = 0;
+
+	if (config.strategy & SEEPROM_REPLAY_COMPARE)
+	{
+		// Current value is read unless it is in RAM
+		if (!((config.strategy & SEEPROM_REPLAY_CACHE) && (w.state & SEEPROM_REPLAY_CACHED)))
+		{
+			stats.reads++;
+			us += config.readUs;
+		}
+
+		// Skip erase of erased word and write which does not change word
+		if (erase ? (w.state & SEEPROM_REPLAY_ERASED) : !changed)
+		{
+			if (config.strategy & SEEPROM_REPLAY_CACHE) w.state |= SEEPROM_REPLAY_CACHED;
+			return us;
+		}
+	}
+
+	if (w.cycles != 0xFFFFFFFF) w.cycles++;
+	stats.programs++;
+	us += config.progUs;
+
+	if (erase) w.state |= SEEPROM_REPLAY_ERASED;
+	else w.state &= ~SEEPROM_REPLAY_ERASED;
+	if (config.strategy & SEEPROM_REPLAY_CACHE) w.state |= SEEPROM_REPLAY_CACHED;
+
+	return us;
+}
+
+uint32_t sEEPROMReplay::flush(const sEEPROMReplayConfig& config, sEEPROMReplayWord* words, sEEPROMReplayStats& stats)
+{
+	uint32_t us = 0;
+
+	for (uint16_t word = 0; word < (config.size / 4); word++)
+	{
+		if (!(words[word].state & SEEPROM_REPLAY_DIRTY)) continue;
+
+		uint8_t changed = (words[word].state & SEEPROM_REPLAY_CHANGED) ? 1 : 0;
+		words[word].state &= ~(SEEPROM_REPLAY_DIRTY | SEEPROM_REPLAY_CHANGED);
+		us += program(config, words, word, words[word].state & SEEPROM_REPLAY_PENDING, changed, stats);
+	}
+
+	return us;
+}
+
+
 #ifdef SEEPROM_CS
 
+// ----- STRUCTS
+/**
+ * @brief Hsiao(39,32) code tables.
+ * 
+ * Data bit columns are first 32 weight-3 7-bit vectors, check bit columns are weight-1 vectors.
+ */
+struct sEEPROMECCTables {
+	uint8_t encode[4][256]; /**< @brief Check bits for each byte value at each byte position. */
+	uint8_t syndrome[128]; /**< @brief Bit position(0-31 data, 32-38 check) for each syndrome or \c 0xFF if uncorrectable. */
+
+	constexpr sEEPROMECCTables() : encode(), syndrome()
+	{
+		uint8_t column[32] = { 0 };
+		uint8_t cnt = 0;
+
+		// Select data bit columns
+		for (uint8_t v = 0; v < 128 && cnt < 32; v++)
+		{
+			uint8_t weight = 0;
+			for (uint8_t bit = 0; bit < 7; bit++) weight += (v >> bit) & 0x1;
+			if (weight == 3) column[cnt++] = v;
+		}
+
+		// Build encode tables
+		for (uint8_t pos = 0; pos < 4; pos++)
+		{
+			for (uint16_t val = 0; val < 256; val++)
+			{
+				uint8_t chk = 0;
+				for (uint8_t bit = 0; bit < 8; bit++)
+				{
+					if (val & (1 << bit)) chk ^= column[pos * 8 + bit];
+				}
+				encode[pos][val] = chk;
+			}
+		}
+
+		// Build syndrome table
+		for (uint8_t s = 0; s < 128; s++) syndrome[s] = 0xFF;
+		for (uint8_t bit = 0; bit < 32; bit++) syndrome[column[bit]] = bit;
+		for (uint8_t bit = 0; bit < 7; bit++) syndrome[1 << bit] = 32 + bit;
+	}
+};
+
+static constexpr sEEPROMECCTables eccTables; /**< @brief Hsiao(39,32) code tables in program flash. */
+
+
+// ----- STATIC VARIABLES
+sEEPROMMutexHandler sEEPROM::mutexTake = nullptr;
+sEEPROMMutexHandler sEEPROM::mutexGive = nullptr;
+uint32_t sEEPROM::irqMask = 0;
+uint8_t sEEPROM::irqNest = 0;
+sEEPROMMutexHandler sEEPROM::queueWait = nullptr;
+uint32_t sEEPROM::queueNext = 0;
+volatile uint32_t sEEPROM::queueServing = 0;
+#ifdef SEEPROM_FAULT_INJECTION
+uint32_t sEEPROM::faultOp = 0;
+uint8_t sEEPROM::faultTorn = 0;
+#endif // SEEPROM_FAULT_INJECTION
+#ifdef SEEPROM_OBSERVER
+uint32_t sEEPROMStats::buckets[SEEPROM_HIST_COUNT][SEEPROM_STATS_BUCKETS];
+uint32_t sEEPROMStats::longest[SEEPROM_HIST_COUNT];
+#endif // SEEPROM_OBSERVER
+#ifdef SEEPROM_TRACE
+sEEPROMTraceEntry sEEPROMTrace::entries[SEEPROM_TRACE];
+uint32_t sEEPROMTrace::next = 0;
+uint32_t sEEPROMTrace::changed[(SEEPROM_SIZE / 4 + 31) / 32];
+#endif // SEEPROM_TRACE
+#ifdef SEEPROM_WEAR
+uint32_t* sEEPROMWear::counters = nullptr;
+#endif // SEEPROM_WEAR
+
+
 // ----- METHOD DEFINITIONS
 sEEPROM::sEEPROM(uint32_t s, uint16_t len)
 {
 	start = s;
-	length = len;
+
+	// Word accesses to unaligned area would fault, so area is left empty
+	length = (s % 4) ? 0 : len;
 }
 
 sEEPROM::~sEEPROM(void)
@@ -46,107 +379,2092 @@ sEEPROM::~sEEPROM(void)
 
 uint8_t sEEPROM::read(uint16_t startOffset, void* output, uint16_t len)
 {
+	sEEPROMSegment segment = { output, len };
+
+	return readv(startOffset, &segment, 1);
+}
+
+uint8_t sEEPROM::write(uint16_t startOffset, void* value, uint16_t len)
+{
+	sEEPROMSegment segment = { value, len };
+
+	return writev(startOffset, &segment, 1);
+}
+
+uint8_t sEEPROM::readv(uint16_t startOffset, const sEEPROMSegment* segments, uint8_t count)
+{
+	uint32_t total = 0;
+	for (uint8_t seg = 0; seg < count; seg++) total += segments[seg].len;
+
 	// If required number of bytes to read go outside EEPROM sector
-	if ((start + startOffset + len) < (start + len)) return SEEPROM_OF;
+	if (outside(startOffset, total)) return SEEPROM_OF;
 
-	uint16_t idx = 0;
+	uint32_t t0 = observeBegin(SEEPROM_OP_READ);
 	uint8_t* addr = (uint8_t*)(start + startOffset);
 
-	do
+	for (uint8_t seg = 0; seg < count; seg++)
 	{
-		// Read value from EEPROM
-		((uint8_t*)output)[idx] = addr[idx];
-
-		// Increase index
-		idx++;
+		for (uint16_t idx = 0; idx < segments[seg].len; idx++)
+		{
+			// Read value from EEPROM
+			((uint8_t*)segments[seg].data)[idx] = *addr;
+			addr++;
+		}
 	}
-	while (idx != len);
+
+	observeEnd(SEEPROM_OP_READ, t0, startOffset, total);
 
 	return SEEPROM_OK;
 }
 
-uint8_t sEEPROM::write(uint16_t startOffset, void* value, uint16_t len)
+uint8_t sEEPROM::writev(uint16_t startOffset, const sEEPROMSegment* segments, uint8_t count)
 {
+	uint32_t total = 0;
+	for (uint8_t seg = 0; seg < count; seg++) total += segments[seg].len;
+
 	// If required number of bytes to write go outside EEPROM sector
-	if ((start + startOffset + len) < (start + len)) return SEEPROM_OF;
+	if (outside(startOffset, total)) return SEEPROM_OF;
+	if (!total) return SEEPROM_OK;
+
+	uint32_t t0 = observeBegin(SEEPROM_OP_WRITE);
+	uint32_t* addr = wordAddr(startOffset & ~0x3);
+	uint8_t pos = startOffset & 0x3;
 
-	// Unlock EEPROM write access
+	// Take FLASH controller before head word is read, so other writer cannot change it in between
+	takeController();
+
+	// Pad head word with current EEPROM content and unlock EEPROM write access
+	uint32_t word = *addr;
 	unlockEEPROM();
 
-	// Calculate number of 4 byte values
-	uint16_t len4 = len / 4;
-	len = len % 4;
+	for (uint8_t seg = 0; seg < count; seg++)
+	{
+		for (uint16_t idx = 0; idx < segments[seg].len; idx++)
+		{
+			// Pack byte into word
+			((uint8_t*)&word)[pos] = ((uint8_t*)segments[seg].data)[idx];
+			pos++;
 
-	// Calculate number of 2 byte values
-	uint16_t len2 = len / 2;
-	len = len % 2;
+			// Write full word
+			if (pos == 4)
+			{
+				programWord(addr, word);
+				addr++;
+				pos = 0;
+			}
+		}
+	}
 
-	// Write 4 bytes values if needed
-	if (len4)
+	// Pad tail word with current EEPROM content and write it
+	if (pos)
 	{
-		write<uint32_t>((uint32_t*)(start + startOffset), (uint32_t*)value, len4);
+		uint32_t cur = *addr;
+		for (; pos < 4; pos++) ((uint8_t*)&word)[pos] = ((uint8_t*)&cur)[pos];
 
-		// Move offset address
-		startOffset += (len4 * 4);
+		programWord(addr, word);
 	}
 
-	// Write 2 byte values if needed
-	if (len2)
+	// Lock EEPROM write access and give FLASH controller back
+	lockEEPROM();
+	giveController();
+
+	observeEnd(SEEPROM_OP_WRITE, t0, startOffset, total);
+
+	return SEEPROM_OK;
+}
+
+uint8_t sEEPROM::writeDiff(uint16_t startOffset, const void* oldValue, const void* newValue, uint16_t len)
+{
+	// Check if offset address and length are aligned by 4 bytes
+	if ((startOffset | len) % 4) return SEEPROM_NOK;
+
+	// If required number of bytes to write go outside EEPROM sector
+	if (outside(startOffset, len)) return SEEPROM_OF;
+
+	uint32_t t0 = observeBegin(SEEPROM_OP_WRITE);
+	const uint32_t* oldWords = (const uint32_t*)oldValue;
+	const uint32_t* newWords = (const uint32_t*)newValue;
+	uint32_t* addr = wordAddr(startOffset);
+	uint8_t unlocked = 0;
+
+	for (uint16_t idx = 0; idx < (len / 4); idx++)
 	{
-		write<uint16_t>((uint16_t*)(start + startOffset), (uint16_t*)((uint16_t*)value + startOffset), len2);
+		// Skip unchanged word
+		if (oldWords[idx] == newWords[idx]) continue;
 
-		// Move offset address
-		startOffset += (len2 * 2);
+		// Take FLASH controller and unlock EEPROM write access on first changed word
+		if (!unlocked)
+		{
+			takeController();
+			unlockEEPROM();
+			unlocked = 1;
+		}
+
+		programWord(addr + idx, newWords[idx]);
 	}
 
-	// Write 1 byte values if needed
-	if (len) write<uint8_t>((uint8_t*)(start + startOffset), (uint8_t*)((uint8_t*)value + startOffset), len);
+	// Lock EEPROM write access and give FLASH controller back
+	if (unlocked)
+	{
+		lockEEPROM();
+		giveController();
+	}
 
-	// Lock EEPROM write access
-	lockEEPROM();
+	observeEnd(SEEPROM_OP_WRITE, t0, startOffset, len);
 
 	return SEEPROM_OK;
 }
 
-uint8_t sEEPROM::erase(uint16_t startOffset, uint16_t len)
+uint8_t sEEPROM::patch(sEEPROMPatch* patches, uint16_t count)
 {
-	// Check if offset address is aligned by 4 bytes
-	if (startOffset % 4) return SEEPROM_NOK;
+	// Check all patches before anything is written
+	for (uint16_t idx = 0; idx < count; idx++)
+	{
+		if (outside(patches[idx].offset, patches[idx].len)) return SEEPROM_OF;
+	}
 
-	// Check for EEPROM overflow
-	if ((start + startOffset + (len * 4)) < (start + (len * 4))) return SEEPROM_OF;
+	// Stable insertion sort by offset
+	for (uint16_t idx = 1; idx < count; idx++)
+	{
+		sEEPROMPatch tmp = patches[idx];
+		uint16_t pos = idx;
+
+		for (; pos && patches[pos - 1].offset > tmp.offset; pos--) patches[pos] = patches[pos - 1];
+		patches[pos] = tmp;
+	}
+
+	// Skip empty patches at the start
+	uint16_t first = 0;
+	while (first < count && !patches[first].len) first++;
+	if (first == count) return SEEPROM_OK;
+
+	uint32_t t0 = observeBegin(SEEPROM_OP_WRITE);
+	uint16_t lowest = patches[first].offset;
+	uint16_t highest = lowest;
+	uint16_t offset = lowest & ~0x3;
+	uint8_t unlocked = 0;
+
+	// Take FLASH controller before first word is read, so other writer cannot change it between compare and program
+	takeController();
+
+	while (first < count)
+	{
+		uint32_t* addr = wordAddr(offset);
+		uint32_t word = *addr;
+
+		// Overlay every patch which covers this word
+		for (uint16_t idx = first; idx < count && patches[idx].offset < (offset + 4); idx++)
+		{
+			const sEEPROMPatch& p = patches[idx];
+			uint16_t from = (p.offset > offset) ? p.offset : offset;
+			uint16_t to = ((p.offset + p.len) < (offset + 4)) ? (p.offset + p.len) : (offset + 4);
+
+			for (; from < to; from++) ((uint8_t*)&word)[from - offset] = p.data[from - p.offset];
+			if (to > highest) highest = to;
+		}
+
+		// Skip matching word
+		if (word != *addr)
+		{
+			// Unlock EEPROM write access on first changed word
+			if (!unlocked)
+			{
+				unlockEEPROM();
+				unlocked = 1;
+			}
+
+			programWord(addr, word);
+		}
+
+		// Drop patches which end in this word and jump to next covered word
+		offset += 4;
+		while (first < count && (patches[first].offset + patches[first].len) <= offset) first++;
+		if (first < count && (patches[first].offset & ~0x3) > offset) offset = patches[first].offset & ~0x3;
+	}
+
+	// Lock EEPROM write access and give FLASH controller back
+	if (unlocked) lockEEPROM();
+	giveController();
+
+	observeEnd(SEEPROM_OP_WRITE, t0, lowest, highest - lowest);
+
+	return SEEPROM_OK;
+}
+
+uint8_t sEEPROM::copy(uint16_t dstOffset, uint16_t srcOffset, uint16_t len)
+{
+	// If source or destination go outside EEPROM sector
+	if (outside(dstOffset, len) || outside(srcOffset, len)) return SEEPROM_OF;
+	if (!len || dstOffset == srcOffset) return SEEPROM_OK;
+
+	uint32_t t0 = observeBegin(SEEPROM_OP_WRITE);
+	uint8_t unlocked = 0;
+
+	// Take FLASH controller before source and destination words are read
+	takeController();
+	transfer(dstOffset, (const uint8_t*)(start + srcOffset), len, unlocked);
+
+	// Lock EEPROM write access and give FLASH controller back
+	if (unlocked) lockEEPROM();
+	giveController();
+
+	observeEnd(SEEPROM_OP_WRITE, t0, dstOffset, len);
+
+	return SEEPROM_OK;
+}
+
+uint8_t sEEPROM::move(uint16_t dstOffset, uint16_t srcOffset, uint16_t len)
+{
+	// If source or destination go outside EEPROM sector
+	if (outside(dstOffset, len) || outside(srcOffset, len)) return SEEPROM_OF;
+	if (!len || dstOffset == srcOffset) return SEEPROM_OK;
+
+	uint32_t t0 = observeBegin(SEEPROM_OP_WRITE);
+	uint8_t unlocked = 0;
+
+	// Take FLASH controller before source and destination words are read
+	takeController();
+	transfer(dstOffset, (const uint8_t*)(start + srcOffset), len, unlocked);
 
+	// Clear part of source which is not covered by destination
+	uint16_t clearFrom = srcOffset;
+	uint16_t clearTo = srcOffset + len;
+	if (dstOffset < srcOffset && (dstOffset + len) > srcOffset) clearFrom = dstOffset + len;
+	if (dstOffset > srcOffset && dstOffset < (srcOffset + len)) clearTo = dstOffset;
+
+	transfer(clearFrom, nullptr, clearTo - clearFrom, unlocked);
+
+	// Lock EEPROM write access and give FLASH controller back
+	if (unlocked) lockEEPROM();
+	giveController();
+
+	observeEnd(SEEPROM_OP_WRITE, t0, dstOffset, len);
+
+	return SEEPROM_OK;
+}
+
+uint8_t sEEPROM::writeImage(const uint8_t* image, uint16_t len)
+{
+	uint16_t version;
+
+	// Check image before anything is written
+	if (outside(0, len)) return SEEPROM_OF;
+	if (sEEPROMImage::verify(image, len, version) != SEEPROM_OK) return SEEPROM_NOK;
+
+	uint32_t t0 = observeBegin(SEEPROM_OP_WRITE);
+	uint8_t unlocked = 0;
+
+	// Take FLASH controller before words are compared, write body first and header last
+	takeController();
+	transfer(SEEPROM_IMAGE_HEADER, image + SEEPROM_IMAGE_HEADER, len - SEEPROM_IMAGE_HEADER, unlocked);
+	transfer(0, image, SEEPROM_IMAGE_HEADER, unlocked);
+
+	// Lock EEPROM write access and give FLASH controller back
+	if (unlocked) lockEEPROM();
+	giveController();
+
+	observeEnd(SEEPROM_OP_WRITE, t0, 0, len);
+
+	return SEEPROM_OK;
+}
+
+uint8_t sEEPROM::fill(uint16_t startOffset, uint16_t len, uint32_t pattern)
+{
+	// If required number of bytes to fill go outside EEPROM sector
+	if (outside(startOffset, len)) return SEEPROM_OF;
+	if (!len) return SEEPROM_OK;
+
+	uint8_t op = pattern ? SEEPROM_OP_WRITE : SEEPROM_OP_ERASE;
+	uint32_t t0 = observeBegin(op);
+	uint16_t end = startOffset + len;
+	uint8_t unlocked = 0;
+
+	// Take FLASH controller before first word is read, so other writer cannot change it between compare and program
+	takeController();
+
+	for (uint16_t offset = startOffset & ~0x3; offset < end; offset += 4)
+	{
+		uint32_t* addr = wordAddr(offset);
+		uint32_t word = pattern;
+
+		// Pad partial word with current EEPROM content
+		if (offset < startOffset || (offset + 4) > end)
+		{
+			word = *addr;
+			for (uint8_t pos = 0; pos < 4; pos++)
+			{
+				if ((offset + pos) >= startOffset && (offset + pos) < end) ((uint8_t*)&word)[pos] = ((uint8_t*)&pattern)[pos];
+			}
+		}
+
+		// Skip matching word
+		if (word == *addr) continue;
+
+		// Unlock EEPROM write access on first changed word
+		if (!unlocked)
+		{
+			unlockEEPROM();
+			unlocked = 1;
+		}
+
+		// Use erase for zero word and program for others, PECR must not change while previous word is in progress
+		waitBusy();
+		if (word)
+		{
+			FLASH->PECR &= ~FLASH_PECR_ERASE;
+			programWord(addr, word);
+		}
+		else
+		{
+			FLASH->PECR |= FLASH_PECR_ERASE;
+			eraseWord(addr);
+		}
+	}
+
+	// Disable EEPROM erase, lock EEPROM write access and give FLASH controller back
+	if (unlocked)
+	{
+		waitBusy();
+		FLASH->PECR &= ~FLASH_PECR_ERASE;
+		lockEEPROM();
+	}
+	giveController();
+
+	observeEnd(op, t0, startOffset, len);
+
+	return SEEPROM_OK;
+}
+
+uint8_t sEEPROM::compare(uint16_t startOffset, const void* data, uint16_t len, uint16_t& mismatch)
+{
+	// If required number of bytes to compare go outside EEPROM sector
+	if (outside(startOffset, len)) return SEEPROM_OF;
+
+	uint32_t t0 = observeBegin(SEEPROM_OP_READ);
+	const uint8_t* addr = (const uint8_t*)(start + startOffset);
+	const uint8_t* bytes = (const uint8_t*)data;
 	uint16_t idx = 0;
-	uint32_t* addr = (uint32_t*)(start + startOffset);
 
-	// Unlock EEPROM write access
-	unlockEEPROM();
+	// Compare whole words if both sides are aligned the same way
+	if ((((uint32_t)(uintptr_t)addr ^ (uint32_t)(uintptr_t)bytes) & 0x3) == 0)
+	{
+		// Compare head bytes up to word boundary
+		while (idx < len && ((uint32_t)(uintptr_t)(addr + idx) & 0x3) && addr[idx] == bytes[idx]) idx++;
 
-	// Enable EEPROM erase
-	FLASH->PECR |= FLASH_PECR_ERASE;
+		// Compare whole words
+		if (!((uint32_t)(uintptr_t)(addr + idx) & 0x3))
+		{
+			while ((idx + 4) <= len && *(const uint32_t*)(addr + idx) == *(const uint32_t*)(bytes + idx)) idx += 4;
+		}
+	}
 
-	do
+	// Compare remaining bytes or find different byte in word
+	for (; idx < len; idx++)
 	{
-		// Erase four bytes
-		addr[idx] = 0x00;
+		if (addr[idx] != bytes[idx]) break;
+	}
 
-		// Wait for interrupt
-		__WFI();
+	mismatch = startOffset + idx;
 
-		// Increase index
-		idx++;
+	observeEnd(SEEPROM_OP_READ, t0, startOffset, idx);
+
+	return (idx == len) ? SEEPROM_OK : SEEPROM_NOK;
+}
+
+uint8_t sEEPROM::findEnd(uint16_t startOffset, uint16_t len, uint16_t& found)
+{
+	// Check if offset address and length are aligned by 4 bytes
+	if ((startOffset | len) % 4) return SEEPROM_NOK;
+
+	// If required number of bytes to search go outside EEPROM sector
+	if (outside(startOffset, len)) return SEEPROM_OF;
+
+	uint32_t t0 = observeBegin(SEEPROM_OP_READ);
+	const uint32_t* addr = wordAddr(startOffset);
+	uint16_t low = 0;
+	uint16_t high = len / 4;
+
+	// Find first erased word in [low, high)
+	while (low < high)
+	{
+		uint16_t mid = (low + high) / 2;
+
+		if (addr[mid]) low = mid + 1;
+		else high = mid;
 	}
-	while (idx != len);
 
-	// Disable EEPROM erase
-	FLASH->PECR &= ~FLASH_PECR_ERASE;
+	found = startOffset + (low * 4);
 
-	// Lock EEPROM write access
-	lockEEPROM();
+	observeEnd(SEEPROM_OP_READ, t0, startOffset, len);
 
 	return SEEPROM_OK;
 }
 
+uint8_t sEEPROM::writeStart(sEEPROMJob& job, uint16_t startOffset, const void* value, uint16_t len)
+{
+	// If required number of bytes to write go outside EEPROM sector
+	if (outside(startOffset, len)) return SEEPROM_OF;
+
+	job.data = (const uint8_t*)value;
+	job.offset = startOffset;
+	job.remaining = len;
+
+	return SEEPROM_OK;
+}
+
+uint8_t sEEPROM::writeStep(sEEPROMJob& job, uint16_t words)
+{
+	if (!job.remaining) return SEEPROM_OK;
+	if (!words) return SEEPROM_BUSY;
+
+	uint32_t t0 = observeBegin(SEEPROM_OP_WRITE);
+	uint16_t startOffset = job.offset;
+	uint16_t len = job.remaining;
+
+	// Take FLASH controller and unlock EEPROM write access
+	takeController();
+	unlockEEPROM();
+
+	while (job.remaining && words)
+	{
+		uint32_t* addr = wordAddr(job.offset & ~0x3);
+		uint8_t pos = job.offset & 0x3;
+
+		// Pad partial word with current EEPROM content
+		uint32_t word = *addr;
+
+		for (; pos < 4 && job.remaining; pos++)
+		{
+			((uint8_t*)&word)[pos] = *job.data;
+			job.data++;
+			job.offset++;
+			job.remaining--;
+		}
+
+		programWord(addr, word);
+		words--;
+	}
+
+	// Lock EEPROM write access and give FLASH controller back
+	lockEEPROM();
+	giveController();
+
+	observeEnd(SEEPROM_OP_WRITE, t0, startOffset, len - job.remaining);
+
+	return job.remaining ? SEEPROM_BUSY : SEEPROM_OK;
+}
+
+uint8_t sEEPROM::writeUrgent(uint16_t startOffset, const uint32_t* value, uint16_t len)
+{
+	// Check if offset address is aligned by 4 bytes
+	if (startOffset % 4) return SEEPROM_NOK;
+
+	// Check for EEPROM overflow
+	if (outside(startOffset, (uint32_t)len * 4)) return SEEPROM_OF;
+
+	uint32_t* addr = wordAddr(startOffset);
+
+	// Finish operation of interrupted session and save its state
+	while (FLASH->SR & FLASH_SR_BSY);
+	uint32_t pecr = FLASH->PECR;
+
+	// Unlock EEPROM write access if needed and disable erase
+	if (pecr & FLASH_PECR_PELOCK) writeKeys();
+	FLASH->PECR &= ~FLASH_PECR_ERASE;
+
+	for (uint16_t idx = 0; idx < len; idx++)
+	{
+		while (FLASH->SR & FLASH_SR_BSY);
+		faultPoint(0);
+		addr[idx] = value[idx];
+		faultPoint(1);
+		wearPoint(&addr[idx]);
+	}
+
+	while (FLASH->SR & FLASH_SR_BSY);
+
+	// Restore state of interrupted session
+	if (pecr & FLASH_PECR_ERASE) FLASH->PECR |= FLASH_PECR_ERASE;
+	if (pecr & FLASH_PECR_PELOCK) FLASH->PECR |= FLASH_PECR_PELOCK;
+
+	return SEEPROM_OK;
+}
+
+uint8_t sEEPROM::erase(uint16_t startOffset, uint16_t len)
+{
+	// Check if offset address is aligned by 4 bytes
+	if (startOffset % 4) return SEEPROM_NOK;
+
+	// Check for EEPROM overflow
+	if (outside(startOffset, (uint32_t)len * 4)) return SEEPROM_OF;
+	if (!len) return SEEPROM_OK;
+
+	uint32_t t0 = observeBegin(SEEPROM_OP_ERASE);
+	uint16_t idx = 0;
+	uint32_t* addr = wordAddr(startOffset);
+
+	// Take FLASH controller and unlock EEPROM write access
+	takeController();
+	unlockEEPROM();
+
+	// Enable EEPROM erase
+	FLASH->PECR |= FLASH_PECR_ERASE;
+
+	do
+	{
+		eraseWord(&addr[idx]);
+
+		// Increase index
+		idx++;
+	}
+	while (idx != len);
+
+	// Disable EEPROM erase
+	FLASH->PECR &= ~FLASH_PECR_ERASE;
+
+	// Lock EEPROM write access and give FLASH controller back
+	lockEEPROM();
+	giveController();
+
+	observeEnd(SEEPROM_OP_ERASE, t0, startOffset, (uint32_t)len * 4);
+
+	return SEEPROM_OK;
+}
+
+
+void sEEPROM::transfer(uint16_t dstOffset, const uint8_t* src, uint16_t len, uint8_t& unlocked)
+{
+	if (!len) return;
+
+	uint16_t first = dstOffset & ~0x3;
+	uint16_t last = (dstOffset + len - 1) & ~0x3;
+	uint8_t descending = src && (uint32_t)(uintptr_t)src < (start + dstOffset);
+	uint16_t offset = descending ? last : first;
+
+	while (1)
+	{
+		uint32_t* addr = wordAddr(offset);
+		uint32_t word = *addr;
+
+		// Pack source bytes into word padded with current EEPROM content
+		for (uint8_t pos = 0; pos < 4; pos++)
+		{
+			uint16_t byte = offset + pos;
+			if (byte < dstOffset || byte >= (dstOffset + len)) continue;
+
+			((uint8_t*)&word)[pos] = src ? src[byte - dstOffset] : 0x00;
+		}
+
+		// Skip matching word
+		if (word != *addr)
+		{
+			// Unlock EEPROM write access on first changed word
+			if (!unlocked)
+			{
+				unlockEEPROM();
+				unlocked = 1;
+			}
+
+			programWord(addr, word);
+		}
+
+		if (offset == (descending ? first : last)) break;
+		offset = descending ? (offset - 4) : (offset + 4);
+	}
+}
+
+
+uint8_t sEEPROM::scan(uint16_t startOffset, uint16_t len, uint32_t value, uint8_t equal, uint16_t& found)
+{
+	// Check if offset address and length are aligned by 4 bytes
+	if ((startOffset | len) % 4) return SEEPROM_NOK;
+
+	// If required number of bytes to search go outside EEPROM sector
+	if (outside(startOffset, len)) return SEEPROM_OF;
+
+	uint32_t t0 = observeBegin(SEEPROM_OP_READ);
+	const uint32_t* addr = wordAddr(startOffset);
+	uint16_t idx = 0;
+
+	for (; idx < (len / 4); idx++)
+	{
+		if ((addr[idx] == value) == (equal != 0)) break;
+	}
+
+	found = startOffset + (idx * 4);
+
+	observeEnd(SEEPROM_OP_READ, t0, startOffset, len);
+
+	return SEEPROM_OK;
+}
+
+// ----- STATIC METHOD DEFINITIONS
+void sEEPROM::setMutex(sEEPROMMutexHandler take, sEEPROMMutexHandler give)
+{
+	mutexTake = take;
+	mutexGive = give;
+}
+
+void sEEPROM::irqTake(void)
+{
+	uint32_t mask = __get_PRIMASK();
+
+	// Mask interrupts
+	__disable_irq();
+
+	// Save interrupt mask on outermost take
+	if (!irqNest) irqMask = mask;
+	irqNest++;
+}
+
+void sEEPROM::irqGive(void)
+{
+	// Nothing to give back
+	if (!irqNest) return;
+
+	// Restore interrupt mask on outermost give
+	irqNest--;
+	if (!irqNest && !irqMask) __enable_irq();
+}
+
+void sEEPROM::queueTake(void)
+{
+	uint32_t mask = __get_PRIMASK();
+
+	// Draw ticket with interrupts masked, Cortex-M0+ has no exclusive access instructions
+	__disable_irq();
+	uint32_t ticket = queueNext;
+	queueNext++;
+	if (!mask) __enable_irq();
+
+	// Wait for own turn
+	while (queueServing != ticket)
+	{
+		if (queueWait) queueWait();
+	}
+}
+
+void sEEPROM::queueGive(void)
+{
+	uint32_t mask = __get_PRIMASK();
+
+	// Hand FLASH controller to next ticket
+	__disable_irq();
+	queueServing = queueServing + 1;
+	if (!mask) __enable_irq();
+}
+
+void sEEPROM::setQueueWait(sEEPROMMutexHandler wait)
+{
+	queueWait = wait;
+}
+
+#ifdef SEEPROM_FAULT_INJECTION
+void sEEPROM::injectFault(uint32_t op, uint8_t torn)
+{
+	faultOp = op;
+	faultTorn = torn;
+}
+#endif // SEEPROM_FAULT_INJECTION
+
+
+// ----- sEEPROMStats METHOD DEFINITIONS
+#ifdef SEEPROM_OBSERVER
+void sEEPROMStats::end(uint8_t op, uint32_t ticks)
+{
+	add(op, ticks);
+}
+
+void sEEPROMStats::program(uint32_t ticks)
+{
+	add(SEEPROM_HIST_PROGRAM, ticks);
+}
+
+void sEEPROMStats::busy(uint32_t ticks)
+{
+	add(SEEPROM_HIST_BUSY, ticks);
+}
+
+uint32_t sEEPROMStats::count(uint8_t hist, uint8_t bucket)
+{
+	if (hist >= SEEPROM_HIST_COUNT || bucket >= SEEPROM_STATS_BUCKETS) return 0;
+	return buckets[hist][bucket];
+}
+
+uint32_t sEEPROMStats::max(uint8_t hist)
+{
+	if (hist >= SEEPROM_HIST_COUNT) return 0;
+	return longest[hist];
+}
+
+void sEEPROMStats::reset(void)
+{
+	for (uint8_t hist = 0; hist < SEEPROM_HIST_COUNT; hist++)
+	{
+		for (uint8_t bucket = 0; bucket < SEEPROM_STATS_BUCKETS; bucket++) buckets[hist][bucket] = 0;
+		longest[hist] = 0;
+	}
+}
+
+void sEEPROMStats::add(uint8_t hist, uint32_t ticks)
+{
+	uint8_t bucket = 0;
+	uint32_t val = ticks;
+
+	// Find log2 bucket
+	while ((val >> 1) && bucket < (SEEPROM_STATS_BUCKETS - 1))
+	{
+		val >>= 1;
+		bucket++;
+	}
+
+	buckets[hist][bucket]++;
+	if (ticks > longest[hist]) longest[hist] = ticks;
+}
+#endif // SEEPROM_OBSERVER
+
+
+// ----- sEEPROMTrace METHOD DEFINITIONS
+#ifdef SEEPROM_TRACE
+void sEEPROMTrace::record(uint8_t op, uint16_t addr, uint16_t len, uint32_t ticks)
+{
+	// Reserve entry
+	uint32_t mask = __get_PRIMASK();
+	__disable_irq();
+	uint32_t idx = next;
+	next = idx + 1;
+	if (!mask) __enable_irq();
+
+	sEEPROMTraceEntry& entry = entries[idx % SEEPROM_TRACE];
+	entry.addr = addr;
+	entry.len = len;
+	entry.info = ((uint32_t)op << 24) | (ticks > 0xFFFFFF ? 0xFFFFFF : ticks);
+	entry.changed = 0;
+	if (op != SEEPROM_OP_WRITE && op != SEEPROM_OP_ERASE) return;
+
+	// Collect and clear marks of entry words
+	uint16_t first = addr / 4;
+	uint16_t words = (addr % 4 + len + 3) / 4;
+	uint8_t sh = sEEPROMTraceEntry::shift(words);
+
+	for (uint16_t word = 0; word < words; word++)
+	{
+		uint16_t at = first + word;
+		if (at >= (SEEPROM_SIZE / 4)) break;
+
+		uint32_t bit = 1UL << (at % 32);
+		if (!(changed[at / 32] & bit)) continue;
+
+		mask = __get_PRIMASK();
+		__disable_irq();
+		changed[at / 32] &= ~bit;
+		if (!mask) __enable_irq();
+
+		entry.changed |= 1UL << (word >> sh);
+	}
+}
+
+void sEEPROMTrace::mark(uint32_t addr)
+{
+	if (addr < SEEPROM_START || addr >= SEEPROM_END) return;
+
+	uint16_t word = (addr - SEEPROM_START) / 4;
+	uint32_t mask = __get_PRIMASK();
+	__disable_irq();
+	changed[word / 32] |= 1UL << (word % 32);
+	if (!mask) __enable_irq();
+}
+
+uint8_t sEEPROMTrace::get(uint16_t idx, sEEPROMTraceEntry& entry)
+{
+	if (idx >= count()) return SEEPROM_NOK;
+
+	// Oldest entry is at next when buffer is full
+	uint32_t first = (next > SEEPROM_TRACE) ? (next - SEEPROM_TRACE) : 0;
+	entry = entries[(first + idx) % SEEPROM_TRACE];
+
+	return SEEPROM_OK;
+}
+
+uint16_t sEEPROMTrace::count(void)
+{
+	return (next > SEEPROM_TRACE) ? SEEPROM_TRACE : next;
+}
+
+void sEEPROMTrace::clear(void)
+{
+	next = 0;
+	for (uint8_t idx = 0; idx < (sizeof(changed) / 4); idx++) changed[idx] = 0;
+}
+#endif // SEEPROM_TRACE
+
+
+// ----- sEEPROMWear METHOD DEFINITIONS
+#ifdef SEEPROM_WEAR
+void sEEPROMWear::attach(uint32_t* counters)
+{
+	sEEPROMWear::counters = counters;
+	if (!counters) return;
+
+	for (uint16_t word = 0; word < (SEEPROM_SIZE / 4); word++) counters[word] = 0;
+}
+
+void sEEPROMWear::record(uint32_t addr)
+{
+	if (!counters || addr < SEEPROM_START || addr >= SEEPROM_END) return;
+
+	// Saturate counter
+	uint32_t& cnt = counters[(addr - SEEPROM_START) / 4];
+	if (cnt != 0xFFFFFFFF) cnt++;
+}
+
+uint32_t sEEPROMWear::count(uint16_t word)
+{
+	if (!counters || word >= (SEEPROM_SIZE / 4)) return 0;
+	return counters[word];
+}
+
+uint16_t sEEPROMWear::hottest(void)
+{
+	uint16_t hot = 0;
+
+	for (uint16_t word = 1; word < (SEEPROM_SIZE / 4); word++)
+	{
+		if (count(word) > count(hot)) hot = word;
+	}
+
+	return hot;
+}
+
+uint32_t sEEPROMWear::project(uint32_t elapsed, uint32_t used, uint32_t endurance)
+{
+	uint32_t cycles = count(hottest());
+	if (!cycles) return 0xFFFFFFFF;
+
+	// Word is already worn out
+	uint64_t total = (uint64_t)used + cycles;
+	if (total >= endurance) return 0;
+
+	// Cycles left from now at observed rate
+	uint64_t ttf = ((endurance - total) * elapsed) / cycles;
+	return (ttf > 0xFFFFFFFF) ? 0xFFFFFFFF : (uint32_t)ttf;
+}
+#endif // SEEPROM_WEAR
+
+
+// ----- sEEPROMECC METHOD DEFINITIONS
+sEEPROMECC::sEEPROMECC(sEEPROM& data, sEEPROM& check)
+{
+	this->data = &data;
+	this->check = &check;
+}
+
+uint8_t sEEPROMECC::read(uint16_t startOffset, void* output, uint16_t len)
+{
+	// Check if offset address and length are aligned by 4 bytes
+	if ((startOffset | len) % 4) return SEEPROM_NOK;
+
+	uint8_t ret = data->read(startOffset, output, len);
+	if (ret != SEEPROM_OK) return ret;
+
+	uint32_t* words = (uint32_t*)output;
+	uint8_t chk[16];
+
+	for (uint16_t idx = 0; idx < (len / 4); idx++)
+	{
+		// Read check bytes in chunks
+		if (!(idx % sizeof(chk)))
+		{
+			uint16_t cnt = (len / 4) - idx;
+			if (cnt > sizeof(chk)) cnt = sizeof(chk);
+
+			uint8_t chkRet = check->read((startOffset / 4) + idx, chk, cnt);
+			if (chkRet != SEEPROM_OK) return chkRet;
+		}
+
+		uint8_t& c = chk[idx % sizeof(chk)];
+		switch (decode(words[idx], c))
+		{
+			case SEEPROM_NOK:
+			{
+				// Remember corrected word for lazy write back
+				uint16_t offset = startOffset + (idx * 4);
+				uint8_t known = 0;
+
+				for (uint8_t p = 0; p < pendingCnt; p++)
+				{
+					if (pendingWords[p] == offset) known = 1;
+				}
+
+				if (!known && pendingCnt < SEEPROM_ECC_PENDING) pendingWords[pendingCnt++] = offset;
+				break;
+			}
+
+			case SEEPROM_ECC:
+			{
+				ret = SEEPROM_ECC;
+				break;
+			}
+
+			default: break;
+		}
+	}
+
+	return ret;
+}
+
+uint8_t sEEPROMECC::write(uint16_t startOffset, const void* value, uint16_t len)
+{
+	// Check if offset address and length are aligned by 4 bytes
+	if ((startOffset | len) % 4) return SEEPROM_NOK;
+
+	// Check both areas before anything is written
+	if ((uint32_t)startOffset + len > data->size() || (uint32_t)(startOffset + len) / 4 > check->size()) return SEEPROM_OF;
+
+	const uint32_t* words = (const uint32_t*)value;
+	uint8_t chk[16];
+	uint16_t idx = 0;
+
+	// Update words in chunks: open check bytes, write data words and commit check bytes
+	while (idx < (len / 4))
+	{
+		uint16_t cnt = (len / 4) - idx;
+		if (cnt > sizeof(chk)) cnt = sizeof(chk);
+
+		for (uint16_t i = 0; i < cnt; i++) chk[i] = SEEPROM_ECC_OPEN;
+		uint8_t ret = check->write((startOffset / 4) + idx, chk, cnt);
+		if (ret != SEEPROM_OK) return ret;
+
+		ret = data->write(startOffset + (idx * 4), (void*)(words + idx), cnt * 4);
+		if (ret != SEEPROM_OK) return ret;
+
+		for (uint16_t i = 0; i < cnt; i++) chk[i] = SEEPROM_ECC_COMMIT | encode(words[idx + i]);
+		ret = check->write((startOffset / 4) + idx, chk, cnt);
+		if (ret != SEEPROM_OK) return ret;
+
+		idx += cnt;
+	}
+
+	return SEEPROM_OK;
+}
+
+uint8_t sEEPROMECC::repair(void)
+{
+	uint8_t cnt = 0;
+
+	while (pendingCnt)
+	{
+		uint16_t offset = pendingWords[--pendingCnt];
+		uint32_t word;
+		uint8_t chk;
+
+		// Read word again, skip it if it is not correctable anymore
+		if (data->read(offset, &word, 4) != SEEPROM_OK || check->read(offset / 4, &chk, 1) != SEEPROM_OK) continue;
+		if (decode(word, chk) != SEEPROM_NOK) continue;
+
+		if (write(offset, &word, 4) == SEEPROM_OK) cnt++;
+	}
+
+	return cnt;
+}
+
+uint8_t sEEPROMECC::encode(uint32_t word)
+{
+	return eccTables.encode[0][word & 0xFF] ^ eccTables.encode[1][(word >> 8) & 0xFF] ^ eccTables.encode[2][(word >> 16) & 0xFF] ^ eccTables.encode[3][word >> 24];
+}
+
+uint8_t sEEPROMECC::decode(uint32_t& word, uint8_t& check)
+{
+	// Update was interrupted before commit, data word is old, new or torn
+	if (!(check & SEEPROM_ECC_COMMIT)) return (word || check) ? SEEPROM_ECC : SEEPROM_OK;
+
+	uint8_t syn = (encode(word) ^ check) & 0x7F;
+	if (!syn) return SEEPROM_OK;
+
+	uint8_t bit = eccTables.syndrome[syn];
+	if (bit == 0xFF) return SEEPROM_ECC;
+
+	// Flip faulty bit
+	if (bit < 32) word ^= (1UL << bit);
+	else check ^= (1 << (bit - 32));
+
+	return SEEPROM_NOK;
+}
+
+
+// ----- sEEPROMWriter METHOD DEFINITIONS
+sEEPROMWriter::sEEPROMWriter(sEEPROM& eeprom, uint16_t startOffset)
+{
+	this->eeprom = &eeprom;
+	base = startOffset & ~0x3;
+	fill = startOffset & 0x3;
+
+	// Pad head word with current EEPROM content
+	if (fill) eeprom.read(base, buffer, fill);
+}
+
+sEEPROMWriter::~sEEPROMWriter(void)
+{
+	close();
+}
+
+uint8_t sEEPROMWriter::write(const void* value, uint16_t len)
+{
+	if (!open) return SEEPROM_NOK;
+
+	// If required number of bytes to write go outside EEPROM sector
+	if ((uint32_t)tell() + len > eeprom->size()) return SEEPROM_OF;
+
+	for (uint16_t idx = 0; idx < len; idx++)
+	{
+		// Buffer byte
+		((uint8_t*)buffer)[fill] = ((const uint8_t*)value)[idx];
+		fill++;
+
+		// Write full buffer
+		if (fill == SEEPROM_STREAM_BUFFER)
+		{
+			uint8_t ret = flush();
+			if (ret != SEEPROM_OK) return ret;
+		}
+	}
+
+	return SEEPROM_OK;
+}
+
+uint8_t sEEPROMWriter::close(void)
+{
+	if (!open) return SEEPROM_NOK;
+
+	// Pad tail word with current EEPROM content up to area end(sEEPROM::write pads bytes behind area end)
+	uint8_t tail = (4 - (fill & 0x3)) & 0x3;
+	if ((uint32_t)tell() + tail > eeprom->size()) tail = eeprom->size() - tell();
+	if (tail) eeprom->read(base + fill, (uint8_t*)buffer + fill, tail);
+	fill += tail;
+
+	uint8_t ret = SEEPROM_OK;
+	if (fill) ret = flush();
+	open = 0;
+
+	return ret;
+}
+
+uint8_t sEEPROMWriter::flush(void)
+{
+	// Buffer holds full aligned words(except at area end)
+	uint8_t ret = eeprom->write(base, buffer, fill);
+
+	base += fill;
+	fill = 0;
+
+	return ret;
+}
+
+
+// ----- sEEPROMReader METHOD DEFINITIONS
+sEEPROMReader::sEEPROMReader(sEEPROM& eeprom, uint16_t startOffset)
+{
+	this->eeprom = &eeprom;
+	cursor = startOffset;
+}
+
+uint8_t sEEPROMReader::read(void* output, uint16_t len)
+{
+	if (!len) return SEEPROM_OK;
+
+	// If required number of bytes to read go outside EEPROM sector
+	if ((uint32_t)cursor + len > eeprom->size()) return SEEPROM_OF;
+
+	eeprom->read(cursor, output, len);
+	cursor += len;
+
+	return SEEPROM_OK;
+}
+
+
+// ----- sEEPROMScrub METHOD DEFINITIONS
+sEEPROMScrub::sEEPROMScrub(sEEPROMECC& ecc, sEEPROM& state, uint16_t stateOffset, uint16_t blockLen)
+{
+	this->ecc = &ecc;
+	this->state = &state;
+	this->stateOffset = stateOffset;
+
+	// Block length is used as divisor and must hold whole words
+	blockLen &= ~0x3;
+	this->blockLen = blockLen ? blockLen : 4;
+}
+
+void sEEPROMScrub::load(void)
+{
+	uint32_t word = 0;
+	state->read(stateOffset, &word, 4);
+
+	// Cursor in lower half, pass counter in upper half
+	cursor = word & 0xFFFF;
+	passCnt = word >> 16;
+
+	// Restart from beginning if state is not valid
+	if (cursor >= ecc->size() || cursor % 4) cursor = 0;
+}
+
+uint8_t sEEPROMScrub::step(uint16_t words)
+{
+	uint8_t ret = SEEPROM_OK;
+	uint32_t buf[4];
+
+	while (words)
+	{
+		// Scrub in chunks which do not cross block or area end
+		uint16_t len = sizeof(buf);
+		if (len > words * 4) len = words * 4;
+		if (len > blockLen - (cursor % blockLen)) len = blockLen - (cursor % blockLen);
+		if (len > ecc->size() - cursor) len = ecc->size() - cursor;
+
+		if (ecc->read(cursor, buf, len) == SEEPROM_ECC)
+		{
+			// Find uncorrectable words
+			for (uint8_t idx = 0; idx < len / 4; idx++)
+			{
+				uint32_t word;
+				if (ecc->read(cursor + (idx * 4), &word, 4) == SEEPROM_ECC) errorCnt++;
+			}
+
+			ret = SEEPROM_ECC;
+		}
+
+		// Write back corrected words
+		repairCnt += ecc->repair();
+
+		cursor += len;
+		words -= len / 4;
+
+		// Wrap at area end
+		if (cursor >= ecc->size())
+		{
+			cursor = 0;
+			passCnt++;
+			save();
+		}
+		else if (!(cursor % blockLen)) save();
+	}
+
+	return ret;
+}
+
+void sEEPROMScrub::save(void)
+{
+	uint32_t word = ((uint32_t)passCnt << 16) | cursor;
+	state->write(stateOffset, &word, 4);
+}
+
+
+// ----- sEEPROMFIFO METHOD DEFINITIONS
+sEEPROMFIFO::sEEPROMFIFO(sEEPROM& eeprom)
+{
+	this->eeprom = &eeprom;
+}
+
+void sEEPROMFIFO::mount(void)
+{
+	uint32_t lastSeq = 0;
+	uint32_t firstSeq = 0xFFFFFFFF;
+
+	head = 0;
+	tail = 0;
+	entries = 0;
+
+	// Scan every word for entry headers
+	for (uint16_t offset = 0; (offset + 8) <= eeprom->size(); offset += 4)
+	{
+		uint32_t seq;
+		uint16_t len;
+		uint8_t consumed;
+
+		if (!header(offset, seq, len, consumed)) continue;
+
+		// Newest entry defines next push position
+		if (seq > lastSeq)
+		{
+			lastSeq = seq;
+			head = offset + entrySize(len);
+		}
+
+		// Oldest not consumed entry is queue tail
+		if (!consumed)
+		{
+			entries++;
+
+			if (seq < firstSeq)
+			{
+				firstSeq = seq;
+				tail = offset;
+			}
+		}
+
+		// Skip entry payload, it is not scanned for headers
+		offset += entrySize(len) - 4;
+	}
+
+	nextSeq = lastSeq + 1;
+	if (head >= eeprom->size()) head = 0;
+	if (!entries) tail = head;
+}
+
+uint8_t sEEPROMFIFO::push(const void* value, uint16_t len)
+{
+	uint16_t size = entrySize(len);
+	uint16_t pos = head;
+
+	if (size > eeprom->size() || !nextSeq) return SEEPROM_NOK;
+
+	// Find free space after head, wrap to start if entry does not fit before end
+	if (entries && pos == tail) return SEEPROM_NOK;
+	if (!entries || pos > tail)
+	{
+		if ((pos + size) > eeprom->size())
+		{
+			pos = 0;
+			if (entries && size > tail) return SEEPROM_NOK;
+		}
+	}
+	else if ((pos + size) > tail) return SEEPROM_NOK;
+
+	// Write payload first, so torn push leaves no valid header
+	if (len && eeprom->write(pos + 8, (void*)value, len) != SEEPROM_OK) return SEEPROM_NOK;
+
+	uint32_t hdr[2] = { nextSeq, len | ((uint32_t)check(nextSeq, len, 0) << 16) };
+	if (eeprom->write(pos, hdr, sizeof(hdr)) != SEEPROM_OK) return SEEPROM_NOK;
+
+	if (!entries) tail = pos;
+	entries++;
+	nextSeq++;
+	head = pos + size;
+	if (head >= eeprom->size()) head = 0;
+
+	return SEEPROM_OK;
+}
+
+uint8_t sEEPROMFIFO::peek(void* output, uint16_t size, uint16_t& len)
+{
+	uint32_t seq;
+	uint8_t consumed;
+
+	if (!entries || !header(tail, seq, len, consumed)) return SEEPROM_NOK;
+	if (len > size) return SEEPROM_OF;
+
+	if (len) eeprom->read(tail + 8, output, len);
+
+	return SEEPROM_OK;
+}
+
+uint8_t sEEPROMFIFO::pop(void* output, uint16_t size, uint16_t& len)
+{
+	uint8_t ret = peek(output, size, len);
+	if (ret != SEEPROM_OK) return ret;
+
+	remove(len);
+
+	return SEEPROM_OK;
+}
+
+uint16_t sEEPROMFIFO::popBatch(void* output, uint16_t size, uint16_t& used)
+{
+	uint16_t cnt = 0;
+	used = 0;
+
+	while (entries && (used + 2) <= size)
+	{
+		uint16_t len;
+		uint8_t* out = (uint8_t*)output + used;
+
+		if (pop(out + 2, size - used - 2, len) != SEEPROM_OK) break;
+
+		// Length prefix
+		out[0] = len & 0xFF;
+		out[1] = len >> 8;
+
+		used += 2 + len;
+		cnt++;
+	}
+
+	return cnt;
+}
+
+bool sEEPROMFIFO::header(uint16_t offset, uint32_t& seq, uint16_t& len, uint8_t& consumed)
+{
+	uint32_t hdr[2];
+	if (eeprom->read(offset, hdr, sizeof(hdr)) != SEEPROM_OK) return false;
+
+	seq = hdr[0];
+	len = hdr[1] & 0xFFFF;
+	if (!seq || (offset + entrySize(len)) > eeprom->size()) return false;
+
+	uint16_t chk = hdr[1] >> 16;
+	if (chk == check(seq, len, 0)) consumed = 0;
+	else if (chk == check(seq, len, 1)) consumed = 1;
+	else return false;
+
+	return true;
+}
+
+void sEEPROMFIFO::remove(uint16_t len)
+{
+	uint32_t seq = 0;
+	eeprom->read(tail, &seq, 4);
+
+	// Mark entry as consumed
+	uint32_t word = len | ((uint32_t)check(seq, len, 1) << 16);
+	eeprom->write(tail + 4, &word, 4);
+
+	entries--;
+	if (!entries)
+	{
+		tail = head;
+		return;
+	}
+
+	// Next entry follows or queue wraps to start
+	uint16_t next = tail + entrySize(len);
+	uint32_t followSeq;
+	uint16_t followLen;
+	uint8_t consumed;
+
+	if (next >= eeprom->size() || !header(next, followSeq, followLen, consumed) || followSeq != (seq + 1)) next = 0;
+	tail = next;
+}
+
+
+// ----- sEEPROMShadow METHOD DEFINITIONS
+sEEPROMShadow::sEEPROMShadow(sEEPROM& eeprom, uint32_t* shadow, uint32_t* dirty)
+{
+	this->eeprom = &eeprom;
+	this->shadow = shadow;
+	this->dirty = dirty;
+}
+
+void sEEPROMShadow::load(void)
+{
+	eeprom->read(0, shadow, eeprom->size());
+	for (uint16_t idx = 0; idx < ((eeprom->size() / 4) + 31) / 32; idx++) dirty[idx] = 0;
+}
+
+uint8_t sEEPROMShadow::read(uint16_t startOffset, void* output, uint16_t len)
+{
+	// If required number of bytes to read go outside EEPROM sector
+	if ((uint32_t)startOffset + len > eeprom->size()) return SEEPROM_OF;
+
+	for (uint16_t idx = 0; idx < len; idx++) ((uint8_t*)output)[idx] = ((uint8_t*)shadow)[startOffset + idx];
+
+	return SEEPROM_OK;
+}
+
+uint8_t sEEPROMShadow::write(uint16_t startOffset, const void* value, uint16_t len)
+{
+	// If required number of bytes to write go outside EEPROM sector
+	if ((uint32_t)startOffset + len > eeprom->size()) return SEEPROM_OF;
+
+	for (uint16_t idx = 0; idx < len; idx++)
+	{
+		uint16_t offset = startOffset + idx;
+		uint8_t val = ((const uint8_t*)value)[idx];
+
+		// Mark changed word dirty
+		if (((uint8_t*)shadow)[offset] == val) continue;
+
+		((uint8_t*)shadow)[offset] = val;
+		dirty[offset / 128] |= (1UL << ((offset / 4) % 32));
+	}
+
+	return SEEPROM_OK;
+}
+
+uint8_t sEEPROMShadow::setPriority(uint16_t startOffset, uint16_t len, uint8_t prio)
+{
+	if (rangeCnt == SEEPROM_SHADOW_RANGES) return SEEPROM_NOK;
+
+	// Cover every word touched by range
+	ranges[rangeCnt].offset = startOffset / 4;
+	ranges[rangeCnt].words = ((startOffset + len + 3) / 4) - (startOffset / 4);
+	ranges[rangeCnt].prio = prio;
+	rangeCnt++;
+
+	return SEEPROM_OK;
+}
+
+uint16_t sEEPROMShadow::flush(void)
+{
+	uint16_t cnt = 0;
+
+	for (uint16_t word = 0; word < (eeprom->size() / 4); word++)
+	{
+		if (!isDirty(word)) continue;
+
+		eeprom->write(word * 4, &shadow[word], 4);
+		dirty[word / 32] &= ~(1UL << (word % 32));
+		cnt++;
+	}
+
+	return cnt;
+}
+
+uint16_t sEEPROMShadow::emergencyFlush(uint32_t us, uint16_t& lost)
+{
+	uint32_t budget = us / SEEPROM_PROG_TIME_US;
+	uint16_t cnt = 0;
+	int16_t prio = 255;
+
+	// Walk priorities from highest to lowest
+	while (prio >= 0 && budget)
+	{
+		int16_t nextPrio = -1;
+
+		for (uint16_t word = 0; word < (eeprom->size() / 4) && budget; word++)
+		{
+			if (!isDirty(word)) continue;
+
+			uint8_t p = priority(word);
+			if (p == prio)
+			{
+				commit(word);
+				budget--;
+				cnt++;
+			}
+			else if (p < prio && p > nextPrio) nextPrio = p;
+		}
+
+		prio = nextPrio;
+	}
+
+	lost = dirtyWords();
+	return cnt;
+}
+
+uint16_t sEEPROMShadow::dirtyWords(void) const
+{
+	uint16_t cnt = 0;
+	for (uint16_t word = 0; word < (eeprom->size() / 4); word++) cnt += isDirty(word);
+
+	return cnt;
+}
+
+uint8_t sEEPROMShadow::priority(uint16_t word) const
+{
+	uint8_t prio = 0;
+
+	for (uint8_t idx = 0; idx < rangeCnt; idx++)
+	{
+		if (word >= ranges[idx].offset && word < (ranges[idx].offset + ranges[idx].words)) prio = ranges[idx].prio;
+	}
+
+	return prio;
+}
+
+void sEEPROMShadow::commit(uint16_t word)
+{
+	eeprom->writeUrgent(word * 4, &shadow[word], 1);
+	dirty[word / 32] &= ~(1UL << (word % 32));
+}
+
+
+// ----- sEEPROMCrash METHOD DEFINITIONS
+uint16_t sEEPROMCrash::dump(sEEPROM& region, uint32_t tag, const uint32_t* value, uint16_t len)
+{
+	if (region.size() < 16) return 0;
+
+	// Truncate dump to region
+	if (len > (region.size() / 4) - 4) len = (region.size() / 4) - 4;
+
+	// Invalidate old dump first
+	put(region, 0, 0);
+
+	put(region, 1, tag);
+	put(region, 2, len);
+	put(region, 3, checksum(tag, value, len));
+	for (uint16_t idx = 0; idx < len; idx++) put(region, 4 + idx, value[idx]);
+
+	// Mark dump as valid
+	put(region, 0, SEEPROM_CRASH_MAGIC);
+
+	return len;
+}
+
+uint8_t sEEPROMCrash::read(sEEPROM& region, uint32_t& tag, uint32_t* output, uint16_t size, uint16_t& len)
+{
+	uint32_t hdr[4];
+	if (region.size() < 16) return SEEPROM_NOK;
+	if (region.read(0, hdr, sizeof(hdr)) != SEEPROM_OK || hdr[0] != SEEPROM_CRASH_MAGIC) return SEEPROM_NOK;
+	if (hdr[2] > (uint32_t)(region.size() / 4) - 4) return SEEPROM_NOK;
+
+	tag = hdr[1];
+	len = hdr[2];
+	if (len > size) return SEEPROM_OF;
+
+	region.read(16, output, len * 4);
+	if (checksum(tag, output, len) != hdr[3]) return SEEPROM_NOK;
+
+	return SEEPROM_OK;
+}
+
+void sEEPROMCrash::clear(sEEPROM& region)
+{
+	uint32_t word = 0;
+	region.write(0, &word, 4);
+}
+
+void sEEPROMCrash::put(sEEPROM& region, uint16_t word, uint32_t value)
+{
+	// Read in place, no hooks from fault context
+	if (region.readUrgent(word * 4) != value) region.writeUrgent(word * 4, &value, 1);
+}
+
+uint32_t sEEPROMCrash::checksum(uint32_t tag, const uint32_t* value, uint16_t len)
+{
+	uint32_t sum = ~tag;
+
+	for (uint16_t idx = 0; idx < len; idx++) sum = ((sum << 1) | (sum >> 31)) ^ value[idx];
+
+	return sum;
+}
+
+
+// ----- sEEPROMDefaults METHOD DEFINITIONS
+sEEPROMDefaults::sEEPROMDefaults(sEEPROM& eeprom, const void* defaults, uint16_t len)
+{
+	this->eeprom = &eeprom;
+	this->defaults = (const uint8_t*)defaults;
+	length = len;
+
+	// One bit per image word, two copies of each bitmap word
+	bitmapLen = ((((len + 3) / 4) + 31) / 32) * 8;
+}
+
+uint8_t sEEPROMDefaults::read(uint16_t startOffset, void* output, uint16_t len)
+{
+	if (!valid(startOffset, len)) return SEEPROM_OF;
+
+	uint16_t end = startOffset + len;
+	uint16_t offset = startOffset;
+	uint16_t loaded = 0xFFFF;
+	uint32_t bits = 0;
+
+	while (offset < end)
+	{
+		uint16_t word = offset / 4;
+
+		// Read bitmap word once per 32 image words
+		if ((word / 32) != loaded)
+		{
+			loaded = word / 32;
+			bits = bitmap(loaded);
+		}
+
+		// Extend run over following words with same state in this bitmap word
+		uint32_t state = (bits >> (word % 32)) & 0x1;
+		uint16_t next = word + 1;
+		while ((next % 32) && (next * 4) < end && ((bits >> (next % 32)) & 0x1) == state) next++;
+
+		uint16_t runEnd = ((next * 4) < end) ? (next * 4) : end;
+		uint8_t* out = (uint8_t*)output + (offset - startOffset);
+
+		// Overridden run is read from EEPROM at once, others are copied from default image
+		if (state) eeprom->read(bitmapLen + offset, out, runEnd - offset);
+		else for (uint16_t idx = offset; idx < runEnd; idx++) *out++ = defaults[idx];
+
+		offset = runEnd;
+	}
+
+	return SEEPROM_OK;
+}
+
+uint8_t sEEPROMDefaults::write(uint16_t startOffset, const void* value, uint16_t len)
+{
+	if (!valid(startOffset, len)) return SEEPROM_OF;
+	if (!len) return SEEPROM_OK;
+
+	uint16_t first = startOffset / 4;
+	uint16_t last = (startOffset + len - 1) / 4;
+
+	for (uint16_t word = first; word <= last; word++)
+	{
+		uint32_t cur = current(word);
+		uint32_t val = cur;
+
+		// Merge new bytes into current word value
+		for (uint8_t pos = 0; pos < 4; pos++)
+		{
+			uint16_t offset = (word * 4) + pos;
+			if (offset >= startOffset && offset < (startOffset + len)) ((uint8_t*)&val)[pos] = ((const uint8_t*)value)[offset - startOffset];
+		}
+
+		// Skip unchanged word
+		if (val == cur) continue;
+
+		// Write data word before its bitmap bit
+		eeprom->write(bitmapLen + (word * 4), &val, 4);
+
+		uint32_t bits = bitmap(word / 32);
+		if (!(bits & (1UL << (word % 32))))
+		{
+			// Torn program of one copy can clear other bits only in that copy, other copy still holds them
+			bits |= (1UL << (word % 32));
+			eeprom->write((word / 32) * 8, &bits, 4);
+			eeprom->write(((word / 32) * 8) + 4, &bits, 4);
+		}
+	}
+
+	return SEEPROM_OK;
+}
+
+uint8_t sEEPROMDefaults::revert(void)
+{
+	if (!valid(0, 0)) return SEEPROM_OF;
+
+	return eeprom->erase(0, bitmapLen / 4);
+}
+
+bool sEEPROMDefaults::overridden(uint16_t word)
+{
+	return bitmap(word / 32) & (1UL << (word % 32));
+}
+
+uint32_t sEEPROMDefaults::bitmap(uint16_t group)
+{
+	uint32_t bits[2] = { 0, 0 };
+	eeprom->read(group * 8, bits, sizeof(bits));
+
+	return bits[0] | bits[1];
+}
+
+uint32_t sEEPROMDefaults::current(uint16_t word)
+{
+	uint32_t val = 0;
+
+	if (overridden(word)) eeprom->read(bitmapLen + (word * 4), &val, 4);
+	else
+	{
+		// Default image may end inside word
+		for (uint8_t pos = 0; pos < 4 && ((word * 4) + pos) < length; pos++) ((uint8_t*)&val)[pos] = defaults[(word * 4) + pos];
+	}
+
+	return val;
+}
+
+
+// ----- sEEPROMMigration METHOD DEFINITIONS
+uint8_t sEEPROMMigration::migrate(sEEPROM& eeprom, uint16_t versionOffset, uint16_t progressOffset, const sEEPROMSchema& from, const sEEPROMSchema& to, sEEPROMMigrationStats* stats)
+{
+	uint32_t version = 0;
+	if (versionOffset % 4 || progressOffset % 4 || eeprom.read(versionOffset, &version, 4) != SEEPROM_OK) return SEEPROM_NOK;
+
+	context ctx;
+	ctx.eeprom = &eeprom;
+	ctx.versionOffset = versionOffset;
+	ctx.progressOffset = progressOffset;
+	ctx.from = from.version;
+	ctx.to = to.version;
+	ctx.sourceCnt = 0;
+
+	// Already migrated, progress words may be left if power was cut before they were cleared
+	if (version == to.version)
+	{
+		finish(ctx);
+		return SEEPROM_OK;
+	}
+
+	if (to.count > SEEPROM_MIGRATE_FIELDS) return SEEPROM_NOK;
+	load(ctx);
+
+	// Version word is torn only if progress was stored before it, finished steps are repeated from stored progress
+	if (version != from.version && !ctx.stored) return SEEPROM_NOK;
+
+	// Validate plan before anything is written
+	ctx.dry = 1;
+	ctx.step = 0;
+	if (run(ctx, from, to) != SEEPROM_OK) return SEEPROM_NOK;
+
+	ctx.dry = 0;
+	ctx.step = 0;
+	run(ctx, from, to);
+
+	// Mark all steps finished, so torn version word is detected after reboot
+	if (!ctx.stored) checkpoint(ctx);
+
+	finish(ctx);
+
+	// Full rewrite of new layout and its version word
+	ctx.stats.naive = 1;
+	for (uint8_t idx = 0; idx < to.count; idx++) ctx.stats.naive += ((to.fields[idx].offset + to.fields[idx].len + 3) / 4) - (to.fields[idx].offset / 4);
+	if (stats) *stats = ctx.stats;
+
+	return SEEPROM_OK;
+}
+
+uint8_t sEEPROMMigration::run(context& ctx, const sEEPROMSchema& from, const sEEPROMSchema& to)
+{
+	uint8_t pending[SEEPROM_MIGRATE_FIELDS];
+	uint8_t left = 0;
+
+	// Find moved fields
+	for (uint8_t idx = 0; idx < to.count; idx++)
+	{
+		const sEEPROMField* old = find(from, to.fields[idx].id);
+		pending[idx] = (old && old->offset != to.fields[idx].offset && old->len && to.fields[idx].len);
+		left += pending[idx];
+	}
+
+	// Execute moves which do not overwrite source of other pending move
+	while (left)
+	{
+		uint8_t sel = 0xFF;
+
+		for (uint8_t idx = 0; idx < to.count && sel == 0xFF; idx++)
+		{
+			if (!pending[idx]) continue;
+
+			const sEEPROMField& dst = to.fields[idx];
+			uint8_t blocked = 0;
+
+			for (uint8_t other = 0; other < to.count; other++)
+			{
+				if (other == idx || !pending[other]) continue;
+
+				const sEEPROMField* src = find(from, to.fields[other].id);
+				uint16_t srcLen = (src->len < to.fields[other].len) ? src->len : to.fields[other].len;
+				if (dst.offset < (src->offset + srcLen) && src->offset < (dst.offset + dst.len)) blocked = 1;
+			}
+
+			if (!blocked) sel = idx;
+		}
+
+		// Moves depend on each other in cycle
+		if (sel == 0xFF) return SEEPROM_NOK;
+
+		const sEEPROMField& dst = to.fields[sel];
+		const sEEPROMField* src = find(from, dst.id);
+		uint16_t len = (src->len < dst.len) ? src->len : dst.len;
+		uint16_t dist = (dst.offset > src->offset) ? (dst.offset - src->offset) : (src->offset - dst.offset);
+
+		if (dist >= len) copyStep(ctx, dst.offset, src->offset, len);
+		else
+		{
+			// Split overlapping move into chunks which do not overlap own source, aligned to destination words
+			uint16_t chunk = (dist < SEEPROM_STREAM_BUFFER) ? dist : SEEPROM_STREAM_BUFFER;
+			if (chunk >= 4) chunk &= ~0x3;
+
+			uint16_t from = dst.offset;
+			uint16_t to = dst.offset + len;
+
+			// Start at end which does not overwrite remaining source
+			while (from < to)
+			{
+				if (dst.offset > src->offset)
+				{
+					uint16_t at = ((to - from) > chunk) ? (to - chunk) : from;
+					if (at > from && chunk >= 4) at = (at + 3) & ~0x3;
+
+					copyStep(ctx, at, src->offset + (at - dst.offset), to - at);
+					to = at;
+				}
+				else
+				{
+					uint16_t at = ((to - from) > chunk) ? (from + chunk) : to;
+					if (at < to && chunk >= 4) at &= ~0x3;
+
+					copyStep(ctx, from, src->offset + (from - dst.offset), at - from);
+					from = at;
+				}
+			}
+		}
+
+		pending[sel] = 0;
+		left--;
+	}
+
+	// Write defaults of added and grown fields
+	for (uint8_t idx = 0; idx < to.count; idx++)
+	{
+		const sEEPROMField& dst = to.fields[idx];
+		const sEEPROMField* src = find(from, dst.id);
+		uint16_t kept = src ? ((src->len < dst.len) ? src->len : dst.len) : 0;
+
+		if (kept == dst.len) continue;
+
+		if (!begin(ctx, dst.offset + kept, dst.len - kept)) continue;
+
+		put(ctx, dst.offset + kept, dst.def ? ((const uint8_t*)dst.def + kept) : nullptr, dst.len - kept);
+		end(ctx, 0, 0);
+	}
+
+	return SEEPROM_OK;
+}
+
+const sEEPROMField* sEEPROMMigration::find(const sEEPROMSchema& schema, uint16_t id)
+{
+	for (uint8_t idx = 0; idx < schema.count; idx++)
+	{
+		if (schema.fields[idx].id == id) return &schema.fields[idx];
+	}
+
+	return nullptr;
+}
+
+void sEEPROMMigration::copyStep(context& ctx, uint16_t dst, uint16_t src, uint16_t len)
+{
+	if (!begin(ctx, dst, len)) return;
+
+	uint8_t buf[SEEPROM_STREAM_BUFFER];
+	uint16_t pos = 0;
+
+	while (pos < len)
+	{
+		uint16_t cnt = ((len - pos) < SEEPROM_STREAM_BUFFER) ? (len - pos) : SEEPROM_STREAM_BUFFER;
+
+		// Step source and destination do not overlap
+		ctx.eeprom->read(src + pos, buf, cnt);
+		put(ctx, dst + pos, buf, cnt);
+
+		pos += cnt;
+	}
+
+	end(ctx, src, len);
+}
+
+void sEEPROMMigration::put(context& ctx, uint16_t dst, const uint8_t* value, uint16_t len)
+{
+	uint16_t pos = 0;
+
+	while (pos < len)
+	{
+		uint16_t offset = (dst + pos) & ~0x3;
+		uint32_t cur;
+		ctx.eeprom->read(offset, &cur, 4);
+
+		// Merge bytes into current word
+		uint32_t word = cur;
+		for (uint8_t idx = (dst + pos) & 0x3; idx < 4 && pos < len; idx++)
+		{
+			((uint8_t*)&word)[idx] = value ? value[pos] : 0x00;
+			pos++;
+		}
+
+		// Program only changed word
+		if (word == cur) continue;
+
+		ctx.eeprom->write(offset, &word, 4);
+		ctx.stats.programmed++;
+	}
+}
+
+uint8_t sEEPROMMigration::begin(context& ctx, uint16_t dst, uint16_t len)
+{
+	// Step was finished before reboot
+	if (ctx.step < ctx.done || ctx.dry)
+	{
+		ctx.step++;
+		return 0;
+	}
+
+	// Store progress only if step overwrites source of step which would be repeated after reboot
+	for (uint8_t idx = 0; idx < ctx.sourceCnt; idx++)
+	{
+		if (dst < ctx.sourceTo[idx] && ctx.sourceFrom[idx] < (dst + len))
+		{
+			checkpoint(ctx);
+			break;
+		}
+	}
+
+	return 1;
+}
+
+void sEEPROMMigration::end(context& ctx, uint16_t src, uint16_t len)
+{
+	ctx.step++;
+	if (!len) return;
+
+	// Extend adjacent source range
+	for (uint8_t idx = 0; idx < ctx.sourceCnt; idx++)
+	{
+		if (src <= ctx.sourceTo[idx] && ctx.sourceFrom[idx] <= (src + len))
+		{
+			if (src < ctx.sourceFrom[idx]) ctx.sourceFrom[idx] = src;
+			if ((src + len) > ctx.sourceTo[idx]) ctx.sourceTo[idx] = src + len;
+			return;
+		}
+	}
+
+	if (ctx.sourceCnt < SEEPROM_MIGRATE_SOURCES)
+	{
+		ctx.sourceFrom[ctx.sourceCnt] = src;
+		ctx.sourceTo[ctx.sourceCnt] = src + len;
+		ctx.sourceCnt++;
+		return;
+	}
+
+	// No room to track source, store progress instead
+	checkpoint(ctx);
+}
+
+void sEEPROMMigration::checkpoint(context& ctx)
+{
+	// Keep newest progress word intact in case this one is torn
+	uint32_t state = ((uint32_t)check(ctx, ctx.step) << 16) | ctx.step;
+	ctx.eeprom->write(ctx.progressOffset + ctx.slot * 4, &state, 4);
+	ctx.stats.progress++;
+
+	ctx.slot ^= 1;
+	ctx.stored = 1;
+
+	// Sources of finished steps are no longer needed
+	ctx.sourceCnt = 0;
+}
+
+void sEEPROMMigration::load(context& ctx)
+{
+	ctx.done = 0;
+	ctx.stored = 0;
+	ctx.slot = 0;
+
+	for (uint8_t idx = 0; idx < 2; idx++)
+	{
+		uint32_t state = 0;
+		ctx.eeprom->read(ctx.progressOffset + idx * 4, &state, 4);
+
+		// Torn progress word or progress of other migration
+		if ((state >> 16) != check(ctx, state & 0xFFFF)) continue;
+
+		if (!ctx.stored || (state & 0xFFFF) > ctx.done)
+		{
+			ctx.done = state & 0xFFFF;
+			ctx.slot = idx ^ 1;
+		}
+		ctx.stored = 1;
+	}
+}
+
+void sEEPROMMigration::finish(context& ctx)
+{
+	uint32_t state = 0;
+	ctx.eeprom->read(ctx.versionOffset, &state, 4);
+
+	// Store new layout version
+	if (state != ctx.to)
+	{
+		state = ctx.to;
+		ctx.eeprom->write(ctx.versionOffset, &state, 4);
+		ctx.stats.progress++;
+	}
+
+	// Progress words must not be found by later migration with same versions
+	for (uint8_t idx = 0; idx < 2; idx++)
+	{
+		ctx.eeprom->read(ctx.progressOffset + idx * 4, &state, 4);
+		if (!state) continue;
+
+		state = 0;
+		ctx.eeprom->write(ctx.progressOffset + idx * 4, &state, 4);
+		ctx.stats.progress++;
+	}
+}
+
+// ----- sEEPROMBlock METHOD DEFINITIONS
+sEEPROMBlock::sEEPROMBlock(sEEPROM& eeprom, uint16_t startOffset, uint16_t len)
+{
+	this->eeprom = &eeprom;
+	start = startOffset;
+	length = len;
+}
+
+uint8_t sEEPROMBlock::format(void)
+{
+	uint32_t crc = 0;
+	if (calculate(crc) != SEEPROM_OK) return SEEPROM_OF;
+
+	return eeprom->write(start + length, &crc, 4);
+}
+
+uint8_t sEEPROMBlock::read(uint16_t offset, void* output, uint16_t len)
+{
+	if (((uint32_t)offset + len) > length) return SEEPROM_OF;
+
+	return eeprom->read(start + offset, output, len);
+}
+
+uint8_t sEEPROMBlock::write(uint16_t offset, const void* value, uint16_t len)
+{
+	if (((uint32_t)offset + len) > length) return SEEPROM_OF;
+	if (((uint32_t)start + length + 4) > eeprom->size()) return SEEPROM_OF;
+
+	// Raw CRC of old ^ new over changed span
+	uint8_t buffer[SEEPROM_STREAM_BUFFER];
+	uint32_t delta = 0;
+	uint8_t changed = 0;
+
+	for (uint16_t done = 0; done < len; done += SEEPROM_STREAM_BUFFER)
+	{
+		uint16_t chunk = ((len - done) < SEEPROM_STREAM_BUFFER) ? (len - done) : SEEPROM_STREAM_BUFFER;
+
+		eeprom->read(start + offset + done, buffer, chunk);
+		for (uint16_t idx = 0; idx < chunk; idx++)
+		{
+			buffer[idx] ^= ((const uint8_t*)value)[done + idx];
+			changed |= buffer[idx];
+		}
+
+		delta = sEEPROMCRC::update(delta, buffer, chunk);
+	}
+
+	// Unchanged span(zero delta alone does not mean unchanged bytes)
+	if (!changed) return SEEPROM_OK;
+
+	// Write data first, then CRC
+	sEEPROMPatch patch = { (uint16_t)(start + offset), len, (const uint8_t*)value };
+	uint8_t ret = eeprom->patch(&patch, 1);
+	if (ret != SEEPROM_OK) return ret;
+
+	// Change is multiple of CRC polynomial, CRC stays the same
+	if (!delta) return SEEPROM_OK;
+
+	// CRC is linear: shift delta over rest of block and add it to stored CRC
+	uint32_t crc = 0;
+	eeprom->read(start + length, &crc, 4);
+	crc ^= sEEPROMCRC::shift(delta, length - offset - len);
+
+	return eeprom->write(start + length, &crc, 4);
+}
+
+uint8_t sEEPROMBlock::verify(void)
+{
+	uint32_t crc = 0;
+	uint32_t stored = 0;
+
+	if (calculate(crc) != SEEPROM_OK) return SEEPROM_OF;
+	eeprom->read(start + length, &stored, 4);
+
+	return (crc == stored) ? SEEPROM_OK : SEEPROM_NOK;
+}
+
+uint8_t sEEPROMBlock::calculate(uint32_t& crc)
+{
+	if (((uint32_t)start + length + 4) > eeprom->size()) return SEEPROM_OF;
+
+	uint8_t buffer[SEEPROM_STREAM_BUFFER];
+	crc = 0xFFFFFFFF;
+
+	for (uint16_t done = 0; done < length; done += SEEPROM_STREAM_BUFFER)
+	{
+		uint16_t chunk = ((length - done) < SEEPROM_STREAM_BUFFER) ? (length - done) : SEEPROM_STREAM_BUFFER;
+
+		eeprom->read(start + done, buffer, chunk);
+		crc = sEEPROMCRC::update(crc, buffer, chunk);
+	}
+
+	crc = ~crc;
+
+	return SEEPROM_OK;
+}
+
+
 #endif // SEEPROM_CS
 
 // END WITH NEW LINE
@@ -37,6 +37,320 @@ This License shall be included in all methodal textual files.
  * It is possible to create multiple objects which represents different parts of EEPROM(eg., EEPROM for device config, EEPROM for device history etc.).
 */
 
+// ----- PORTABLE
+// Parts below do not access EEPROM peripheral. Define SEEPROM_HOST to use them in host tools without supported chip.
+
+// ----- INCLUDE FILES
+#include			<stdint.h>
+
+
+// ----- DEFINES
+// ERROR CODES
+#define SEEPROM_NOK				0 /**< @brief Return code for not OK status. */
+#define SEEPROM_OK				1 /**< @brief Return code for OK status. */
+#define SEEPROM_OF				2 /**< @brief Return code for prevented overflow. */
+#define SEEPROM_ECC				3 /**< @brief Return code for uncorrectable data error. */
+#define SEEPROM_BUSY			4 /**< @brief Return code for unfinished operation. */
+
+// IMAGE
+#define SEEPROM_IMAGE_MAGIC		0x5345 /**< @brief Marker in upper half of \ref sEEPROMImage header word. */
+#define SEEPROM_IMAGE_HEADER	8 /**< @brief Size of \ref sEEPROMImage header in bytes. */
+
+// OPERATIONS
+#define SEEPROM_OP_READ			0 /**< @brief Read operation. */
+#define SEEPROM_OP_WRITE		1 /**< @brief Write operation. */
+#define SEEPROM_OP_ERASE		2 /**< @brief Erase operation. */
+#define SEEPROM_OP_UNLOCK		3 /**< @brief EEPROM unlock operation. */
+#define SEEPROM_OP_COUNT		4 /**< @brief Number of operation types. */
+
+// REPLAY STRATEGIES
+#define SEEPROM_REPLAY_CACHE	(1 << 0) /**< @brief \ref sEEPROMReplay serves reads of already read or written words from RAM copy. */
+#define SEEPROM_REPLAY_COALESCE	(1 << 1) /**< @brief \ref sEEPROMReplay holds written words in RAM and programs them once per flush period. Reads of held words are served from RAM. */
+#define SEEPROM_REPLAY_COMPARE	(1 << 2) /**< @brief \ref sEEPROMReplay reads word first and programs it only if value changes. */
+
+// REPLAY WORD STATE
+#define SEEPROM_REPLAY_CACHED	(1 << 0) /**< @brief Word value is in RAM copy. */
+#define SEEPROM_REPLAY_DIRTY	(1 << 1) /**< @brief Word is held for programming. */
+#define SEEPROM_REPLAY_PENDING	(1 << 2) /**< @brief Held word value is erased value. */
+#define SEEPROM_REPLAY_ERASED	(1 << 3) /**< @brief EEPROM word is known to be erased. */
+#define SEEPROM_REPLAY_CHANGED	(1 << 4) /**< @brief Held word value differs from EEPROM word. */
+
+
+// ----- STRUCTS
+/**
+ * @brief Field of EEPROM layout.
+ * 
+ */
+struct sEEPROMField {
+	uint16_t id; /**< @brief Field ID. Same field keeps its ID across layout versions. */
+	uint16_t offset; /**< @brief Field offset in bytes. */
+	uint16_t len; /**< @brief Field length in bytes. */
+	const void* def; /**< @brief Pointer to field default value or \c nullptr for zeros. */
+};
+
+/**
+ * @brief Versioned EEPROM layout.
+ * 
+ */
+struct sEEPROMSchema {
+	uint16_t version; /**< @brief Layout version. */
+	const sEEPROMField* fields; /**< @brief Pointer to array of fields. */
+	uint8_t count; /**< @brief Number of members in \c fields array. */
+};
+
+/**
+ * @brief EEPROM patch.
+ * 
+ */
+struct sEEPROMPatch {
+	uint16_t offset; /**< @brief Patch offset in bytes. */
+	uint16_t len; /**< @brief Patch length in bytes. */
+	const uint8_t* data; /**< @brief Pointer to patch bytes. */
+};
+
+/**
+ * @brief EEPROM operation trace entry.
+ * 
+ */
+struct sEEPROMTraceEntry {
+	uint16_t addr; /**< @brief Operation start address offset from \c SEEPROM_START in bytes. */
+	uint16_t len; /**< @brief Operation length in bytes. */
+	uint32_t info; /**< @brief Operation type(see \c SEEPROM_OP_ defines) in bits 31-24 and saturated duration in ticks in bits 23-0. */
+	uint32_t changed; /**< @brief Write and erase entries: bit \c n is set if any word in \c n -th group of entry words was programmed with new value. See \ref shift. */
+
+	/**
+	 * @brief Get group size of \ref changed bits.
+	 * 
+	 * Group size is smallest power of two which fits entry words in 32 groups, so entries up to 32 words have one bit per word.
+	 * 
+	 * @param words Number of words covered by entry.
+	 * @return Group size as power of two.
+	 */
+	static inline uint8_t shift(uint32_t words)
+	{
+		uint8_t sh = 0;
+		while (((words + (1UL << sh) - 1) >> sh) > 32) sh++;
+
+		return sh;
+	}
+};
+
+/**
+ * @brief \ref sEEPROMReplay parameters.
+ * 
+ */
+struct sEEPROMReplayConfig {
+	uint8_t strategy = 0; /**< @brief Replay strategy. Combination of \c SEEPROM_REPLAY_ defines, \c 0 replays trace as recorded. */
+	uint16_t size = 2048; /**< @brief EEPROM size in bytes. Must be multiple of 4. Default is STM32L051 EEPROM size. */
+	uint32_t progUs = 3940; /**< @brief Word program or erase time in microseconds. Default is STM32L051 maximum program time. */
+	uint32_t readUs = 1; /**< @brief Word read time in microseconds. */
+	uint16_t flush = 16; /**< @brief With \c SEEPROM_REPLAY_COALESCE, dirty words are programmed after every \c flush trace entries and at trace end. */
+};
+
+/**
+ * @brief Per word \ref sEEPROMReplay state.
+ * 
+ */
+struct sEEPROMReplayWord {
+	uint32_t cycles; /**< @brief Number of program and erase cycles. */
+	uint8_t state; /**< @brief Word state. See \c SEEPROM_REPLAY_ word state defines. */
+};
+
+/**
+ * @brief Result of \ref sEEPROMReplay::run.
+ * 
+ */
+struct sEEPROMReplayStats {
+	uint32_t reads = 0; /**< @brief Number of EEPROM word reads. */
+	uint32_t programs = 0; /**< @brief Number of word program and erase operations. */
+	uint64_t us = 0; /**< @brief Projected EEPROM busy time in microseconds. */
+	uint32_t blocking = 0; /**< @brief Longest projected blocking time of one trace entry or flush in microseconds. */
+	uint64_t ticks = 0; /**< @brief Sum of recorded durations in ticks. */
+	uint16_t hottest = 0; /**< @brief Index of word with most cycles. */
+	uint32_t cycles = 0; /**< @brief Cycles of most worn word. */
+};
+
+
+// ----- CLASSES
+/**
+ * @brief CRC-32(IEEE 802.3, reflected polynomial \c 0xEDB88320).
+ * 
+ * Uses 16 entry table.
+ */
+class sEEPROMCRC {
+	// PUBLIC STUFF
+	public:
+	// STATIC METHOD DECLARATIONS
+	/**
+	 * @brief Update raw CRC register.
+	 * 
+	 * No initial value and final XOR are applied.
+	 * 
+	 * @param crc CRC register value.
+	 * @param data Pointer to input bytes.
+	 * @param len Number of input bytes.
+	 * @return New CRC register value.
+	 */
+	static uint32_t update(uint32_t crc, const void* data, uint16_t len);
+
+	/**
+	 * @brief Calculate CRC-32.
+	 * 
+	 * @param data Pointer to input bytes.
+	 * @param len Number of input bytes.
+	 * @return CRC-32 value.
+	 */
+	static inline uint32_t crc32(const void* data, uint16_t len)
+	{
+		return ~update(0xFFFFFFFF, data, len);
+	}
+
+	/**
+	 * @brief Advance raw CRC register over \c len zero bytes.
+	 * 
+	 * Multiplies \c crc by x^(8 * \c len) modulo CRC polynomial in log2(\c len) steps.
+	 * 
+	 * @param crc CRC register value.
+	 * @param len Number of zero bytes.
+	 * @return New CRC register value.
+	 */
+	static uint32_t shift(uint32_t crc, uint32_t len);
+
+	/**
+	 * @brief Combine CRC-32 of two consecutive blocks.
+	 * 
+	 * @param crc1 CRC-32 of first block.
+	 * @param crc2 CRC-32 of second block.
+	 * @param len2 Length of second block in bytes.
+	 * @return CRC-32 of both blocks.
+	 */
+	static inline uint32_t combine(uint32_t crc1, uint32_t crc2, uint32_t len2)
+	{
+		return shift(crc1, len2) ^ crc2;
+	}
+
+
+	// PRIVATE STUFF
+	private:
+	// STATIC METHOD DECLARATIONS
+	/**
+	 * @brief Multiply two polynomials modulo CRC polynomial.
+	 * 
+	 * @param a First polynomial(reflected).
+	 * @param b Second polynomial(reflected).
+	 * @return Product modulo CRC polynomial(reflected).
+	 */
+	static uint32_t multiply(uint32_t a, uint32_t b);
+};
+
+/**
+ * @brief EEPROM image builder.
+ * 
+ * Image starts with header word(\c SEEPROM_IMAGE_MAGIC in upper half, layout version in lower half) and CRC-32 word of rest of image.
+ * Fields must not overlap header.
+ */
+class sEEPROMImage {
+	// PUBLIC STUFF
+	public:
+	// STATIC METHOD DECLARATIONS
+	/**
+	 * @brief Build image from layout.
+	 * 
+	 * Bytes outside fields are zero(erased EEPROM).
+	 * 
+	 * @param image Pointer to output image.
+	 * @param size Image size in bytes(eg., \c SEEPROM_SIZE).
+	 * @param layout Reference to layout.
+	 * @param values Pointer to array with pointer to value of each layout field. \c nullptr array or member selects field default.
+	 * @return \c SEEPROM_OF if field goes outside image or overlaps header.
+	 * @return \c SEEPROM_OK if image is built.
+	 */
+	static uint8_t build(uint8_t* image, uint16_t size, const sEEPROMSchema& layout, const void* const* values = nullptr);
+
+	/**
+	 * @brief Check image header and CRC.
+	 * 
+	 * @param image Pointer to image.
+	 * @param size Image size in bytes.
+	 * @param version Reference to output layout version.
+	 * @return \c SEEPROM_NOK if image is not valid.
+	 * @return \c SEEPROM_OK if image is valid.
+	 */
+	static uint8_t verify(const uint8_t* image, uint16_t size, uint16_t& version);
+
+	/**
+	 * @brief Diff two images into minimal list of word aligned patches.
+	 * 
+	 * Adjacent changed words are merged into one patch. Patch data points into \c newImage.
+	 * 
+	 * @param oldImage Pointer to current image.
+	 * @param newImage Pointer to new image.
+	 * @param size Image size in bytes. Must be multiple of 4.
+	 * @param patches Pointer to output patch array.
+	 * @param max Size of \c patches array.
+	 * @param count Reference to output number of patches.
+	 * @return \c SEEPROM_OF if \c patches array is too small.
+	 * @return \c SEEPROM_OK if diff is done.
+	 */
+	static uint8_t diff(const uint8_t* oldImage, const uint8_t* newImage, uint16_t size, sEEPROMPatch* patches, uint16_t max, uint16_t& count);
+};
+
+/**
+ * @brief Replay of recorded EEPROM trace(see \ref sEEPROMTrace).
+ * 
+ * Trace is replayed against word model of EEPROM with selected strategy to project EEPROM busy time and word wear.
+ * Compare results of same trace replayed without and with strategy to find latency and wear savings.
+ */
+class sEEPROMReplay {
+	// PUBLIC STUFF
+	public:
+	// STATIC METHOD DECLARATIONS
+	/**
+	 * @brief Replay trace.
+	 * 
+	 * Unlock entries are skipped. Erased state of words is tracked from erase entries, so compare skips erase of erased word exactly.
+	 * Compare skips written word if its group in \ref sEEPROMTraceEntry::changed is clear. Coalesced word is programmed at flush if any held write changed it.
+	 * Replay as recorded programs every word in write and erase entry, also words which driver skipped because they already matched.
+	 * 
+	 * @param trace Pointer to trace entries, oldest first.
+	 * @param count Number of trace entries.
+	 * @param config Reference to replay parameters.
+	 * @param words Pointer to array with \c config.size / 4 members. Array is cleared and holds word cycles after replay.
+	 * @param stats Reference to output statistics.
+	 * @return \c SEEPROM_OF if trace entry goes outside \c config.size bytes.
+	 * @return \c SEEPROM_OK if trace is replayed.
+	 */
+	static uint8_t run(const sEEPROMTraceEntry* trace, uint32_t count, const sEEPROMReplayConfig& config, sEEPROMReplayWord* words, sEEPROMReplayStats& stats);
+
+
+	// PRIVATE STUFF
+	private:
+	// STATIC METHOD DECLARATIONS
+	/**
+	 * @brief Replay write or erase of one word.
+	 * 
+	 * @param config Reference to replay parameters.
+	 * @param words Pointer to word state array.
+	 * @param word Word index.
+	 * @param erase Word is erased.
+	 * @param changed Written value differs from EEPROM word.
+	 * @param stats Reference to statistics.
+	 * @return Projected blocking time in microseconds.
+	 */
+	static uint32_t program(const sEEPROMReplayConfig& config, sEEPROMReplayWord* words, uint16_t word, uint8_t erase, uint8_t changed, sEEPROMReplayStats& stats);
+
+	/**
+	 * @brief Program all dirty words.
+	 * 
+	 * @param config Reference to replay parameters.
+	 * @param words Pointer to word state array.
+	 * @param stats Reference to statistics.
+	 * @return Projected blocking time in microseconds.
+	 */
+	static uint32_t flush(const sEEPROMReplayConfig& config, sEEPROMReplayWord* words, sEEPROMReplayStats& stats);
+};
+
+
 // STM32L051
 #ifdef STM32L051xx
 
@@ -46,179 +360,2698 @@ This License shall be included in all methodal textual files.
 */
 
 
-// ----- INCLUDE FILES
-#include			<stm32l051xx.h>
-#include			<system_stm32l0xx.h>
+// ----- INCLUDE FILES
+#include			<stm32l051xx.h>
+#include			<system_stm32l0xx.h>
+
+
+// ----- DEFINES
+// EEPROM
+#define SEEPROM_START			0x08080000 /**< @brief EEPROM start address. */
+#define SEEPROM_SIZE			2048 /**< @brief EEPROM size in bytes. */
+#define SEEPROM_END				(SEEPROM_START + SEEPROM_SIZE) /**< @brief EEPROM end address. */
+#define SEEPROM_ENDURANCE		100000 /**< @brief Rated EEPROM word endurance in cycles(at 85 degC). */
+#define SEEPROM_PROG_TIME_US	3940 /**< @brief Maximum EEPROM word program time in microseconds. */
+
+// VALUES
+#define PEKEY_VALUE_1			0x89ABCDEF /**< @brief Value 1 to unlock EEPROM and PECR. */
+#define PEKEY_VALUE_2			0x02030405 /**< @brief Value 2 to unlock EEPROM and PECR. */
+#define SEEPROM_CRASH_MAGIC		0x43525348 /**< @brief Marker of valid \ref sEEPROMCrash dump. */
+
+// HISTOGRAMS
+#define SEEPROM_HIST_PROGRAM	SEEPROM_OP_COUNT /**< @brief \ref sEEPROMStats histogram of word program durations. */
+#define SEEPROM_HIST_BUSY		(SEEPROM_OP_COUNT + 1) /**< @brief \ref sEEPROMStats histogram of BSY wait durations. */
+#define SEEPROM_HIST_COUNT		(SEEPROM_OP_COUNT + 2) /**< @brief Number of \ref sEEPROMStats histograms. */
+
+// CONFIGURATION
+#ifndef SEEPROM_STREAM_BUFFER
+#define SEEPROM_STREAM_BUFFER	16 /**< @brief Size of \ref sEEPROMWriter buffer in bytes. Must be multiple of 4. */
+#endif // SEEPROM_STREAM_BUFFER
+
+// Define SEEPROM_OBSERVER as name of class with static begin(op), end(op, ticks), program(ticks) and busy(ticks) methods to observe driver operations(eg., \ref sEEPROMStats).
+// SEEPROM_TIMESTAMP() must return free running 32-bit tick counter(Cortex-M0+ has no DWT cycle counter, use timer counter or HAL_GetTick()).
+#if defined(SEEPROM_OBSERVER) && !defined(SEEPROM_TIMESTAMP)
+#error "sEEPROM: SEEPROM_TIMESTAMP() must be defined when SEEPROM_OBSERVER is used!"
+#endif
+
+#ifndef SEEPROM_STATS_BUCKETS
+#define SEEPROM_STATS_BUCKETS	16 /**< @brief Number of log2 buckets in \ref sEEPROMStats histograms. */
+#endif // SEEPROM_STATS_BUCKETS
+
+#ifndef SEEPROM_ECC_PENDING
+#define SEEPROM_ECC_PENDING		4 /**< @brief Number of corrected words \ref sEEPROMECC remembers for write back. */
+#endif // SEEPROM_ECC_PENDING
+
+#define SEEPROM_ECC_COMMIT		(1 << 7) /**< @brief Check byte bit which marks committed word update. */
+#define SEEPROM_ECC_OPEN		0x7F /**< @brief Check byte of word which is being updated. Differs from erased check byte, so word torn to zero is not taken as erased. */
+
+#ifndef SEEPROM_PRIO_COUNT
+#define SEEPROM_PRIO_COUNT		2 /**< @brief Number of \ref sEEPROMScheduler priority lanes. Lane \c 0 has highest priority. */
+#endif // SEEPROM_PRIO_COUNT
+
+#ifndef SEEPROM_SHADOW_RANGES
+#define SEEPROM_SHADOW_RANGES	4 /**< @brief Number of \ref sEEPROMShadow priority ranges. */
+#endif // SEEPROM_SHADOW_RANGES
+
+#ifndef SEEPROM_MIGRATE_FIELDS
+#define SEEPROM_MIGRATE_FIELDS	32 /**< @brief Maximum number of fields in \ref sEEPROMSchema for \ref sEEPROMMigration. */
+#endif // SEEPROM_MIGRATE_FIELDS
+
+#ifndef SEEPROM_MIGRATE_SOURCES
+#define SEEPROM_MIGRATE_SOURCES	4 /**< @brief Number of source ranges \ref sEEPROMMigration tracks between stored progress words. */
+#endif // SEEPROM_MIGRATE_SOURCES
+
+// Define SEEPROM_TRACE as number of \ref sEEPROMTrace ring buffer entries to record read, write and erase operations. Durations are recorded only if SEEPROM_TIMESTAMP() is defined.
+
+// Define SEEPROM_WEAR to count word program and erase cycles with \ref sEEPROMWear.
+
+// Define SEEPROM_FAULT_INJECTION to enable power cut fault injection(see \ref sEEPROM::injectFault).
+
+
+// ----- TYPEDEFS
+/**
+ * @brief Handler type for FLASH controller arbitration.
+ * 
+ * Pair of these handlers is used to take and give FLASH controller between multiple \ref sEEPROM objects.
+ */
+typedef void (*sEEPROMMutexHandler)(void);
+
+
+// ----- STRUCTS
+/**
+ * @brief Memory segment for scatter-gather EEPROM access.
+ * 
+ */
+struct sEEPROMSegment {
+	void* data; /**< @brief Pointer to segment data. */
+	uint16_t len; /**< @brief Segment length in bytes. */
+};
+
+/**
+ * @brief Continuation handle of chunked EEPROM write.
+ * 
+ */
+struct sEEPROMJob {
+	const uint8_t* data = nullptr; /**< @brief Pointer to next input byte. */
+	uint16_t offset = 0; /**< @brief Offset of next byte in bytes. */
+	uint16_t remaining = 0; /**< @brief Number of bytes left to write. */
+};
+
+
+// ----- CLASSES
+/**
+ * @brief Ready-made driver observer which collects latency histograms.
+ * 
+ * Use it with \c \#define \c SEEPROM_OBSERVER \c sEEPROMStats. Bucket \c n counts durations from \c 2^n to \c 2^(n+1)-1 ticks, last bucket counts all longer durations.
+ */
+class sEEPROMStats {
+	// PUBLIC STUFF
+	public:
+	// STATIC METHOD DECLARATIONS
+	/**
+	 * @brief Operation begin hook.
+	 * 
+	 * @param op Operation type. See \c SEEPROM_OP_ defines.
+	 * @return No return value.
+	 */
+	static inline void begin(uint8_t op)
+	{
+		(void)op;
+	}
+
+	/**
+	 * @brief Operation end hook.
+	 * 
+	 * @param op Operation type. See \c SEEPROM_OP_ defines.
+	 * @param ticks Operation duration in ticks.
+	 * @return No return value.
+	 */
+	static void end(uint8_t op, uint32_t ticks);
+
+	/**
+	 * @brief Word program hook.
+	 * 
+	 * @param ticks Word program duration in ticks.
+	 * @return No return value.
+	 */
+	static void program(uint32_t ticks);
+
+	/**
+	 * @brief BSY wait hook.
+	 * 
+	 * @param ticks BSY wait duration in ticks.
+	 * @return No return value.
+	 */
+	static void busy(uint32_t ticks);
+
+	/**
+	 * @brief Get histogram bucket.
+	 * 
+	 * @param hist Histogram. \c SEEPROM_OP_ define or \c SEEPROM_HIST_PROGRAM or \c SEEPROM_HIST_BUSY.
+	 * @param bucket Bucket index.
+	 * @return Number of samples in bucket.
+	 */
+	static uint32_t count(uint8_t hist, uint8_t bucket);
+
+	/**
+	 * @brief Get longest sample.
+	 * 
+	 * @param hist Histogram. \c SEEPROM_OP_ define or \c SEEPROM_HIST_PROGRAM or \c SEEPROM_HIST_BUSY.
+	 * @return Longest sample in ticks.
+	 */
+	static uint32_t max(uint8_t hist);
+
+	/**
+	 * @brief Clear all histograms.
+	 * 
+	 * @return No return value.
+	 */
+	static void reset(void);
+
+
+	// PRIVATE STUFF
+	private:
+	// STATIC VARIABLES
+	static uint32_t buckets[SEEPROM_HIST_COUNT][SEEPROM_STATS_BUCKETS]; /**< @brief Histogram buckets. */
+	static uint32_t longest[SEEPROM_HIST_COUNT]; /**< @brief Longest sample per histogram. */
+
+	// STATIC METHOD DECLARATIONS
+	/**
+	 * @brief Add sample to histogram.
+	 * 
+	 * @param hist Histogram index.
+	 * @param ticks Sample in ticks.
+	 * @return No return value.
+	 */
+	static void add(uint8_t hist, uint32_t ticks);
+};
+
+/**
+ * @brief RAM ring buffer with trace of EEPROM operations.
+ * 
+ * Enabled with \c SEEPROM_TRACE define. When buffer is full, oldest entries are overwritten.
+ * Entries are 12 bytes long and can be dumped as they are for replay with \ref sEEPROMReplay.
+ * Programmed words which get new value are marked until their write or erase entry is recorded, so entry tells which of its words changed.
+ */
+class sEEPROMTrace {
+	// PUBLIC STUFF
+	public:
+	// STATIC METHOD DECLARATIONS
+	/**
+	 * @brief Record operation.
+	 * 
+	 * @param op Operation type. See \c SEEPROM_OP_ defines.
+	 * @param addr Operation start address offset from \c SEEPROM_START in bytes.
+	 * @param len Operation length in bytes.
+	 * @param ticks Operation duration in ticks.
+	 * @return No return value.
+	 */
+	static void record(uint8_t op, uint16_t addr, uint16_t len, uint32_t ticks);
+
+	/**
+	 * @brief Mark EEPROM word which is programmed with new value.
+	 * 
+	 * @param addr EEPROM word address.
+	 * @return No return value.
+	 */
+	static void mark(uint32_t addr);
+
+	/**
+	 * @brief Get recorded entry.
+	 * 
+	 * @param idx Entry index. \c 0 is oldest entry.
+	 * @param entry Reference to output entry.
+	 * @return \c SEEPROM_NOK if \c idx is out of range.
+	 * @return \c SEEPROM_OK if \c entry is filled.
+	 */
+	static uint8_t get(uint16_t idx, sEEPROMTraceEntry& entry);
+
+	/**
+	 * @brief Get number of recorded entries.
+	 * 
+	 * @return Number of entries in buffer.
+	 */
+	static uint16_t count(void);
+
+	/**
+	 * @brief Clear trace.
+	 * 
+	 * @return No return value.
+	 */
+	static void clear(void);
+
+
+	// PRIVATE STUFF
+	private:
+	#ifdef SEEPROM_TRACE
+	// STATIC VARIABLES
+	static sEEPROMTraceEntry entries[SEEPROM_TRACE]; /**< @brief Ring buffer. */
+	static uint32_t next; /**< @brief Free running index of next entry. */
+	static uint32_t changed[(SEEPROM_SIZE / 4 + 31) / 32]; /**< @brief Words marked with \ref mark, one bit per EEPROM word. */
+	#endif // SEEPROM_TRACE
+};
+
+/**
+ * @brief EEPROM wear accounting.
+ * 
+ * Enabled with \c SEEPROM_WEAR define. Counts word program and erase cycles per EEPROM word into user provided RAM array and projects time to failure from observed rate.
+ */
+class sEEPROMWear {
+	// PUBLIC STUFF
+	public:
+	// STATIC METHOD DECLARATIONS
+	/**
+	 * @brief Attach counter array.
+	 * 
+	 * @param counters Pointer to array with one counter per EEPROM word(\c SEEPROM_SIZE / 4 members). Counters are cleared. Pass \c nullptr to stop counting.
+	 * @return No return value.
+	 */
+	static void attach(uint32_t* counters);
+
+	/**
+	 * @brief Count one cycle of EEPROM word.
+	 * 
+	 * @param addr Address of EEPROM word.
+	 * @return No return value.
+	 */
+	static void record(uint32_t addr);
+
+	/**
+	 * @brief Get number of cycles of EEPROM word.
+	 * 
+	 * @param word Word index from \c SEEPROM_START.
+	 * @return Number of counted cycles.
+	 */
+	static uint32_t count(uint16_t word);
+
+	/**
+	 * @brief Find most worn EEPROM word.
+	 * 
+	 * @return Word index from \c SEEPROM_START.
+	 */
+	static uint16_t hottest(void);
+
+	/**
+	 * @brief Project time to failure of most worn EEPROM word.
+	 * 
+	 * Projection assumes that cycles counted during \c elapsed time repeat at same rate. Returned time is counted from now.
+	 * 
+	 * @param elapsed Time since counters were attached in any unit.
+	 * @param used Number of cycles most worn word had before counters were attached.
+	 * @param endurance Rated word endurance in cycles.
+	 * @return Projected time to failure in \c elapsed units or \c 0xFFFFFFFF if no cycles are counted.
+	 */
+	static uint32_t project(uint32_t elapsed, uint32_t used = 0, uint32_t endurance = SEEPROM_ENDURANCE);
+
+
+	// PRIVATE STUFF
+	private:
+	#ifdef SEEPROM_WEAR
+	// STATIC VARIABLES
+	static uint32_t* counters; /**< @brief Pointer to counter array. */
+	#endif // SEEPROM_WEAR
+};
+
+/**
+ * @brief EEPROM class.
+ * 
+ */
+class sEEPROM {
+	// PUBLIC STUFF
+	public:
+	// OBJECT CONSTRUCTORS AND DECONSTRUCTORS
+	/**
+	 * @brief Object constructor.
+	 * 
+	 * Words are programmed with 32-bit accesses, so \c s must be aligned by 4 bytes. Object with unaligned start address has zero length and every access returns \c SEEPROM_OF.
+	 * 
+	 * @param s EEPROM start address. Must be aligned by 4 bytes.
+	 * @param len EEPROM length in bytes.
+	 * @return No return value.
+	 */
+	sEEPROM(uint32_t s, uint16_t len);
+
+	/**
+	 * @brief Object deconstructor.
+	 * 
+	 * @return No return value.
+	 */
+	~sEEPROM(void);
+
+
+	/**
+	 * @brief Read \c len bytes from EEPROM.
+	 * 
+	 * @param startOffset Start address offset in bytes.
+	 * @param output Pointer to output array.
+	 * @param len Size of \c output array in bytes.
+	 * @return \c SEEPROM_OF if reading \c len bytes will go outside defined area.
+	 * @return \c SEEPROM_OK is read is successful.
+	 */
+	uint8_t read(uint16_t startOffset, void* output, uint16_t len);
+
+	/**
+	 * @brief Write \c len bytes to EEPROM.
+	 * 
+	 * Bytes are written as aligned words. Partial head and tail words are padded with current EEPROM content.
+	 * 
+	 * @param startOffset Start address offset in bytes.
+	 * @param value Pointer to input values to write.
+	 * @param len Length of \c value in bytes.
+	 * @return \c SEEPROM_OF if writing \c len bytes will overflow defined area.
+	 * @return \c SEEPROM_OK is write is successful.
+	 */
+	uint8_t write(uint16_t startOffset, void* value, uint16_t len);
+
+	/**
+	 * @brief Read contiguous EEPROM range into \c count segments.
+	 * 
+	 * @param startOffset Start address offset in bytes.
+	 * @param segments Pointer to array of output segments.
+	 * @param count Number of members in \c segments array.
+	 * @return \c SEEPROM_OF if reading all segments will go outside defined area.
+	 * @return \c SEEPROM_OK if read is successful.
+	 */
+	uint8_t readv(uint16_t startOffset, const sEEPROMSegment* segments, uint8_t count);
+
+	/**
+	 * @brief Write \c count segments to contiguous EEPROM range.
+	 * 
+	 * Segments are written as one stream in single unlocked session. Bytes are packed to aligned words across segment boundaries and partial head and tail words are padded with current EEPROM content.
+	 * 
+	 * @param startOffset Start address offset in bytes.
+	 * @param segments Pointer to array of input segments.
+	 * @param count Number of members in \c segments array.
+	 * @return \c SEEPROM_OF if writing all segments will overflow defined area.
+	 * @return \c SEEPROM_OK if write is successful.
+	 */
+	uint8_t writev(uint16_t startOffset, const sEEPROMSegment* segments, uint8_t count);
+
+	/**
+	 * @brief Write only words which differ between \c oldValue and \c newValue.
+	 * 
+	 * Buffers are compared word by word in RAM, EEPROM is not read. \c oldValue must match current EEPROM content.
+	 * EEPROM is unlocked only if at least one word differs.
+	 * 
+	 * @param startOffset Start address offset in bytes. Must be aligned by 4 bytes.
+	 * @param oldValue Pointer to word aligned buffer with current EEPROM content.
+	 * @param newValue Pointer to word aligned buffer with new values.
+	 * @param len Length of buffers in bytes. Must be multiple of 4.
+	 * @return \c SEEPROM_NOK if \c startOffset or \c len is not aligned by 4 bytes.
+	 * @return \c SEEPROM_OF if writing \c len bytes will overflow defined area.
+	 * @return \c SEEPROM_OK if write is successful.
+	 */
+	uint8_t writeDiff(uint16_t startOffset, const void* oldValue, const void* newValue, uint16_t len);
+
+	/**
+	 * @brief Apply list of patches in one EEPROM write session.
+	 * 
+	 * \c patches array is sorted by offset in place. Where patches overlap, patch with higher offset wins(equal offsets keep array order).
+	 * Patched bytes are packed into words padded with current EEPROM content. Words which already match are skipped.
+	 * Words are written in ascending order and depend only on patch data, so after power loss same patch list can be applied again to finish the job.
+	 * 
+	 * @param patches Pointer to array of patches. Offsets are relative to object start.
+	 * @param count Number of members in \c patches array.
+	 * @return \c SEEPROM_OF if any patch goes outside defined area. Nothing is written.
+	 * @return \c SEEPROM_OK if patches are applied.
+	 */
+	uint8_t patch(sEEPROMPatch* patches, uint16_t count);
+
+	/**
+	 * @brief Copy \c len bytes inside defined area.
+	 * 
+	 * Overlapping ranges are handled(\c memmove semantics), but overlapping copy is not power-safe because source words are overwritten. Bytes are streamed word by word straight from EEPROM, RAM buffer is not needed.
+	 * Destination words which already match are skipped.
+	 * 
+	 * @param dstOffset Destination address offset in bytes.
+	 * @param srcOffset Source address offset in bytes.
+	 * @param len Number of bytes to copy.
+	 * @return \c SEEPROM_OF if source or destination goes outside defined area.
+	 * @return \c SEEPROM_OK if copy is successful.
+	 */
+	uint8_t copy(uint16_t dstOffset, uint16_t srcOffset, uint16_t len);
+
+	/**
+	 * @brief Move \c len bytes inside defined area.
+	 * 
+	 * Same as \ref copy, but source bytes not covered by destination are cleared to \c 0x00 afterwards.
+	 * For non-overlapping ranges power loss leaves complete data in source, destination or both.
+	 * Overlapping move is not power-safe: destination words overwrite source words, so power loss can leave neither copy complete. Move through free area with two non-overlapping moves when data must survive power loss.
+	 * 
+	 * @param dstOffset Destination address offset in bytes.
+	 * @param srcOffset Source address offset in bytes.
+	 * @param len Number of bytes to move.
+	 * @return \c SEEPROM_OF if source or destination goes outside defined area.
+	 * @return \c SEEPROM_OK if move is successful.
+	 */
+	uint8_t move(uint16_t dstOffset, uint16_t srcOffset, uint16_t len);
+
+	/**
+	 * @brief Write \ref sEEPROMImage to start of defined area.
+	 * 
+	 * Image header and CRC are checked before anything is written. Only words which differ are programmed, image body first and header last, so interrupted write leaves area which fails \ref sEEPROMImage::verify.
+	 * 
+	 * @param image Pointer to image built with \ref sEEPROMImage::build.
+	 * @param len Image size in bytes.
+	 * @return \c SEEPROM_NOK if image header or CRC is not valid. Nothing is written.
+	 * @return \c SEEPROM_OF if image does not fit in defined area.
+	 * @return \c SEEPROM_OK if image is written.
+	 */
+	uint8_t writeImage(const uint8_t* image, uint16_t len);
+
+	/**
+	 * @brief Compare \c len bytes of EEPROM with \c data.
+	 * 
+	 * EEPROM is read in place, a word at a time when \c data is word aligned against EEPROM.
+	 * 
+	 * @param startOffset Start address offset in bytes.
+	 * @param data Pointer to bytes to compare with.
+	 * @param len Number of bytes to compare.
+	 * @param mismatch Reference to output offset of first different byte. Set to \c startOffset + \c len if there is no difference.
+	 * @return \c SEEPROM_NOK if content differs.
+	 * @return \c SEEPROM_OF if \c len bytes go outside defined area.
+	 * @return \c SEEPROM_OK if content is equal.
+	 */
+	uint8_t compare(uint16_t startOffset, const void* data, uint16_t len, uint16_t& mismatch);
+
+	/**
+	 * @brief Find first word equal to \c value.
+	 * 
+	 * @param startOffset Start address offset in bytes. Must be aligned by 4 bytes.
+	 * @param len Number of bytes to search. Must be multiple of 4.
+	 * @param value Word to find.
+	 * @param found Reference to output offset of found word. Set to \c startOffset + \c len if word is not found.
+	 * @return \c SEEPROM_NOK if \c startOffset or \c len is not aligned by 4 bytes.
+	 * @return \c SEEPROM_OF if \c len bytes go outside defined area.
+	 * @return \c SEEPROM_OK if search is done.
+	 */
+	inline uint8_t find(uint16_t startOffset, uint16_t len, uint32_t value, uint16_t& found)
+	{
+		return scan(startOffset, len, value, 1, found);
+	}
+
+	/**
+	 * @brief Find first erased(\c 0x00000000) word.
+	 * 
+	 * @param startOffset Start address offset in bytes. Must be aligned by 4 bytes.
+	 * @param len Number of bytes to search. Must be multiple of 4.
+	 * @param found Reference to output offset of found word. Set to \c startOffset + \c len if word is not found.
+	 * @return Same as \ref find.
+	 */
+	inline uint8_t findErased(uint16_t startOffset, uint16_t len, uint16_t& found)
+	{
+		return scan(startOffset, len, 0x00000000, 1, found);
+	}
+
+	/**
+	 * @brief Find first non-erased word.
+	 * 
+	 * @param startOffset Start address offset in bytes. Must be aligned by 4 bytes.
+	 * @param len Number of bytes to search. Must be multiple of 4.
+	 * @param found Reference to output offset of found word. Set to \c startOffset + \c len if word is not found.
+	 * @return Same as \ref find.
+	 */
+	inline uint8_t findUsed(uint16_t startOffset, uint16_t len, uint16_t& found)
+	{
+		return scan(startOffset, len, 0x00000000, 0, found);
+	}
+
+	/**
+	 * @brief Find first erased word in monotonically filled region with binary search.
+	 * 
+	 * Region must hold non-erased words followed only by erased words(eg., append-only log). Takes log2(\c len / 4) word reads.
+	 * 
+	 * @param startOffset Start address offset in bytes. Must be aligned by 4 bytes.
+	 * @param len Number of bytes to search. Must be multiple of 4.
+	 * @param found Reference to output offset of first erased word. Set to \c startOffset + \c len if region is full.
+	 * @return Same as \ref find.
+	 */
+	uint8_t findEnd(uint16_t startOffset, uint16_t len, uint16_t& found);
+
+	/**
+	 * @brief Fill \c len bytes with repeating \c pattern.
+	 * 
+	 * \c pattern is laid on EEPROM words, so byte at offset \c o gets byte \c o % 4 of \c pattern(little endian).
+	 * Words which already match are skipped. Words which become \c 0x00000000 are erased instead of programmed.
+	 * Unaligned head and tail words are padded with current EEPROM content.
+	 * 
+	 * @param startOffset Start address offset in bytes.
+	 * @param len Number of bytes to fill.
+	 * @param pattern Fill pattern. Use \c 0x00000000 to clear region.
+	 * @return \c SEEPROM_OF if \c len bytes go outside defined area.
+	 * @return \c SEEPROM_OK if fill is successful.
+	 */
+	uint8_t fill(uint16_t startOffset, uint16_t len, uint32_t pattern = 0x00000000);
+
+	/**
+	 * @brief Prepare chunked write of \c len bytes.
+	 * 
+	 * Nothing is written. Use \ref writeStep to write the bytes. \c value must stay valid until \c job is done.
+	 * 
+	 * @param job Reference to job handle.
+	 * @param startOffset Start address offset in bytes.
+	 * @param value Pointer to input values to write.
+	 * @param len Length of \c value in bytes.
+	 * @return \c SEEPROM_OF if writing \c len bytes will overflow defined area.
+	 * @return \c SEEPROM_OK if job is prepared.
+	 */
+	uint8_t writeStart(sEEPROMJob& job, uint16_t startOffset, const void* value, uint16_t len);
+
+	/**
+	 * @brief Continue chunked write with at most \c words word programs.
+	 * 
+	 * Worst case blocking time is \c words * \c SEEPROM_PROG_TIME_US plus EEPROM unlock and lock.
+	 * 
+	 * @param job Reference to job handle.
+	 * @param words Maximum number of word programs.
+	 * @return \c SEEPROM_BUSY if job has more bytes to write.
+	 * @return \c SEEPROM_OK if job is done.
+	 */
+	uint8_t writeStep(sEEPROMJob& job, uint16_t words);
+
+	/**
+	 * @brief Continue chunked write for at most \c us microseconds of word programs.
+	 * 
+	 * @param job Reference to job handle.
+	 * @param us Time budget in microseconds.
+	 * @return \c SEEPROM_BUSY if job has more bytes to write.
+	 * @return \c SEEPROM_OK if job is done.
+	 */
+	inline uint8_t writeFor(sEEPROMJob& job, uint32_t us)
+	{
+		uint32_t words = us / SEEPROM_PROG_TIME_US;
+		return writeStep(job, (words > 0xFFFF) ? 0xFFFF : words);
+	}
+
+	/**
+	 * @brief Write \c len words from interrupt or fault context.
+	 * 
+	 * FLASH controller arbitration, observer hooks and \c __WFI are not used, BSY flag is polled. Fault injection points are kept(see \ref injectFault).
+	 * PECR lock and erase state of interrupted session is saved and restored, so it can be called while other write or erase is in progress.
+	 * 
+	 * @param startOffset Start address offset in bytes. Must be aligned by 4 bytes.
+	 * @param value Pointer to input words.
+	 * @param len Number of words to write.
+	 * @return \c SEEPROM_NOK if \c startOffset is not aligned by 4 bytes.
+	 * @return \c SEEPROM_OF if writing \c len words will overflow defined area.
+	 * @return \c SEEPROM_OK if write is successful.
+	 */
+	uint8_t writeUrgent(uint16_t startOffset, const uint32_t* value, uint16_t len);
+
+	/**
+	 * @brief Read one word from interrupt or fault context.
+	 * 
+	 * Word is read in place. Bounds are not checked and observer hooks are not used.
+	 * 
+	 * @param startOffset Word address offset in bytes. Must be aligned by 4 bytes and inside defined area.
+	 * @return Word value.
+	 */
+	inline uint32_t readUrgent(uint16_t startOffset) const
+	{
+		return *wordAddr(startOffset);
+	}
+
+	/**
+	 * @brief Erase \c len words in EEPROM.
+	 * 
+	 * @param startOffset Start address offset in bytes.
+	 * @param len Number of words to erase.
+	 * @return \c SEEPROM_NOK if \c len is not aligned by 4 bytes.
+	 * @return \c SEEPROM_OF if erasing \c len words will erase words outside defined area.
+	 * @return \c SEEPROM_OK if erasing is successful.
+	 */
+	uint8_t erase(uint16_t startOffset, uint16_t len);
+
+	/**
+	 * @brief Get EEPROM length.
+	 * 
+	 * @return EEPROM length in bytes.
+	 */
+	inline uint16_t size(void) const
+	{
+		return length;
+	}
+
+
+	// STATIC METHOD DECLARATIONS
+	/**
+	 * @brief Set FLASH controller arbitration handlers.
+	 * 
+	 * All \ref sEEPROM objects share one FLASH controller. \c take is called before EEPROM is unlocked and \c give after EEPROM is locked again, so write and erase sessions from different objects(and tasks) never interleave.
+	 * Pass \c nullptr for both handlers for no arbitration(default). Use \ref irqTake and \ref irqGive for bare-metal arbitration.
+	 * For FreeRTOS, wrap \c xSemaphoreTake(mutex, portMAX_DELAY) and \c xSemaphoreGive(mutex) on mutex created with \c xSemaphoreCreateMutex. Waiting tasks are served in priority order and mutex provides priority inheritance.
+	 * Use \ref queueTake and \ref queueGive when waiting tasks must be served in request order instead.
+	 * Controller is taken before first word which is rewritten is read and nested takes are not made.
+	 * 
+	 * @param take Pointer to handler which takes FLASH controller. Handler must block until FLASH controller is available.
+	 * @param give Pointer to handler which gives FLASH controller back.
+	 * @return No return value.
+	 */
+	static void setMutex(sEEPROMMutexHandler take, sEEPROMMutexHandler give);
+
+	/**
+	 * @brief Bare-metal FLASH controller take handler.
+	 * 
+	 * Masks interrupts. Nested calls are allowed.
+	 * 
+	 * @return No return value.
+	 */
+	static void irqTake(void);
+
+	/**
+	 * @brief Bare-metal FLASH controller give handler.
+	 * 
+	 * Restores interrupt mask when outermost \ref irqTake is given back.
+	 * 
+	 * @return No return value.
+	 */
+	static void irqGive(void);
+
+	/**
+	 * @brief FIFO FLASH controller take handler.
+	 * 
+	 * Caller draws ticket with interrupts masked and waits until its ticket is served, so waiting tasks get FLASH controller in request order regardless of their priority.
+	 * Wait handler set with \ref setQueueWait is called while waiting. It must let other tasks run(eg., \c vTaskDelay(1)), otherwise task holding FLASH controller may never give it back.
+	 * Do not use from interrupt context.
+	 * 
+	 * @return No return value.
+	 */
+	static void queueTake(void);
+
+	/**
+	 * @brief FIFO FLASH controller give handler.
+	 * 
+	 * Hands FLASH controller to next ticket.
+	 * 
+	 * @return No return value.
+	 */
+	static void queueGive(void);
+
+	/**
+	 * @brief Set handler called while \ref queueTake waits for its ticket.
+	 * 
+	 * @param wait Pointer to wait handler or \c nullptr for busy wait.
+	 * @return No return value.
+	 */
+	static void setQueueWait(sEEPROMMutexHandler wait);
+
+	#ifdef SEEPROM_FAULT_INJECTION
+	/**
+	 * @brief Arm power cut fault injection.
+	 * 
+	 * MCU is reset with \c NVIC_SystemReset during \c op -th following word program or erase operation(counted across all objects).
+	 * With \c torn set to \c 0 reset happens before operation is issued, so \c op - 1 operations are complete.
+	 * With \c torn set to \c 1 reset happens right after operation is issued and while EEPROM is still busy, leaving torn word.
+	 * Keep sweep progress outside of RAM(eg., RTC backup register), remount and check invariants after reset.
+	 * 
+	 * @param op Operation number to cut power at. \c 0 disarms fault injection.
+	 * @param torn Cut power after operation is issued.
+	 * @return No return value.
+	 */
+	static void injectFault(uint32_t op, uint8_t torn);
+	#endif // SEEPROM_FAULT_INJECTION
+
+
+	// PRIVATE STUFF
+	private:
+	// VARIABLES
+	uint32_t start = 0x0; /**< @brief EEPROM start address. */
+	uint16_t length = 0x0; /**< @brief EEPROM length in bytes. */
+
+	// STATIC VARIABLES
+	static sEEPROMMutexHandler mutexTake; /**< @brief FLASH controller take handler. */
+	static sEEPROMMutexHandler mutexGive; /**< @brief FLASH controller give handler. */
+	static uint32_t irqMask; /**< @brief PRIMASK value before outermost \ref irqTake. */
+	static uint8_t irqNest; /**< @brief \ref irqTake nesting level. */
+	static sEEPROMMutexHandler queueWait; /**< @brief \ref queueTake wait handler. */
+	static uint32_t queueNext; /**< @brief Next \ref queueTake ticket. */
+	static volatile uint32_t queueServing; /**< @brief Ticket which holds FLASH controller. */
+	#ifdef SEEPROM_FAULT_INJECTION
+	static uint32_t faultOp; /**< @brief Number of operations left until power cut. */
+	static uint8_t faultTorn; /**< @brief Cut power after operation is issued. */
+	#endif // SEEPROM_FAULT_INJECTION
+
+	// METHOD DECLARATIONS
+	/**
+	 * @brief Check if EEPROM range goes outside defined area.
+	 * 
+	 * @param startOffset Start address offset in bytes.
+	 * @param len Range length in bytes.
+	 * @return \c true if range goes outside defined area.
+	 * @return \c false if range is inside defined area.
+	 */
+	inline bool outside(uint16_t startOffset, uint32_t len) const
+	{
+		return ((uint32_t)startOffset + len) > length;
+	}
+
+	/**
+	 * @brief Get pointer to EEPROM word.
+	 * 
+	 * @param startOffset Word address offset in bytes. Must be aligned by 4 bytes.
+	 * @return Pointer to EEPROM word.
+	 */
+	inline uint32_t* wordAddr(uint16_t startOffset) const
+	{
+		return (uint32_t*)(start + startOffset);
+	}
+
+	/**
+	 * @brief Program one EEPROM word.
+	 * 
+	 * EEPROM must be unlocked.
+	 * 
+	 * @param addr Pointer to EEPROM word.
+	 * @param value Word value.
+	 * @return No return value.
+	 */
+	inline void programWord(uint32_t* addr, uint32_t value)
+	{
+		write<uint32_t>(addr, &value, 1);
+	}
+
+	/**
+	 * @brief Erase one EEPROM word.
+	 * 
+	 * EEPROM must be unlocked and erase must be enabled in PECR.
+	 * 
+	 * @param addr Pointer to EEPROM word.
+	 * @return No return value.
+	 */
+	inline void eraseWord(uint32_t* addr)
+	{
+		// Erase four bytes
+		tracePoint(addr, *addr != 0x00);
+		faultPoint(0);
+		uint32_t tw = timestamp();
+		*addr = 0x00;
+		faultPoint(1);
+		wearPoint(addr);
+
+		// Wait for interrupt
+		__WFI();
+
+		// Wait for EEPROM if still busy(WFI returns immediately with masked interrupts)
+		waitBusy();
+		observeProgram(tw);
+	}
+
+	/**
+	 * @brief Backend write method.
+	 * 
+	 * This method handles writes to EEPROM. It is called by main write method.
+	 * 
+	 * @tparam T \c value type
+	 * @param startAddr Start address.
+	 * @param value Pointer to array with values of \c T type.
+	 * @param len Number of members in \c value array.
+	 */
+	template<typename T>
+	void write(T* startAddr, T* value, uint16_t len)
+	{
+		uint16_t idx = 0;
+
+		do
+		{
+			// Wait for EEPROM if busy
+			waitBusy();
+
+			// Write value
+			tracePoint(&startAddr[idx], startAddr[idx] != value[idx]);
+			faultPoint(0);
+			uint32_t t0 = timestamp();
+			startAddr[idx] = value[idx];
+			faultPoint(1);
+			wearPoint(&startAddr[idx]);
+			observeProgram(t0);
+
+			// Increase index
+			idx++;
+		}
+		while (idx != len);		
+	}
+
+	/**
+	 * @brief Program \c len bytes from \c src at \c dstOffset word by word.
+	 * 
+	 * Words are written in descending order when \c src is below destination, so overlapping EEPROM source is read before it is overwritten.
+	 * Words which already match are skipped. EEPROM is unlocked on first changed word, FLASH controller must be taken by caller.
+	 * 
+	 * @param dstOffset Destination address offset in bytes.
+	 * @param src Pointer to source bytes or \c nullptr for zeros.
+	 * @param len Number of bytes.
+	 * @param unlocked Reference to session state. Set to 1 once EEPROM is unlocked.
+	 * @return No return value.
+	 */
+	void transfer(uint16_t dstOffset, const uint8_t* src, uint16_t len, uint8_t& unlocked);
+
+	/**
+	 * @brief Scan words for first word which is(or is not) equal to \c value.
+	 * 
+	 * @param startOffset Start address offset in bytes. Must be aligned by 4 bytes.
+	 * @param len Number of bytes to search. Must be multiple of 4.
+	 * @param value Word to compare with.
+	 * @param equal Set to 1 to find equal word or to 0 to find different word.
+	 * @param found Reference to output offset of found word. Set to \c startOffset + \c len if word is not found.
+	 * @return Same as \ref find.
+	 */
+	uint8_t scan(uint16_t startOffset, uint16_t len, uint32_t value, uint8_t equal, uint16_t& found);
+
+	/**
+	 * @brief Wait while EEPROM is busy.
+	 * 
+	 * @return No return value.
+	 */
+	static inline void waitBusy(void)
+	{
+		uint32_t t0 = timestamp();
+
+		while (FLASH->SR & FLASH_SR_BSY);
+
+		#ifdef SEEPROM_OBSERVER
+		SEEPROM_OBSERVER::busy(timestamp() - t0);
+		#else
+		(void)t0;
+		#endif // SEEPROM_OBSERVER
+	}
+
+	/**
+	 * @brief Get observer timestamp.
+	 * 
+	 * @return Timestamp in ticks or \c 0 without \c SEEPROM_TIMESTAMP.
+	 */
+	static inline uint32_t timestamp(void)
+	{
+		#ifdef SEEPROM_TIMESTAMP
+		return SEEPROM_TIMESTAMP();
+		#else
+		return 0;
+		#endif // SEEPROM_TIMESTAMP
+	}
+
+	/**
+	 * @brief Report operation begin to observer.
+	 * 
+	 * @param op Operation type. See \c SEEPROM_OP_ defines.
+	 * @return Operation start timestamp.
+	 */
+	static inline uint32_t observeBegin(uint8_t op)
+	{
+		#ifdef SEEPROM_OBSERVER
+		SEEPROM_OBSERVER::begin(op);
+		#else
+		(void)op;
+		#endif // SEEPROM_OBSERVER
+
+		return timestamp();
+	}
+
+	/**
+	 * @brief Report operation end to observer and trace.
+	 * 
+	 * @param op Operation type. See \c SEEPROM_OP_ defines.
+	 * @param t0 Operation start timestamp.
+	 * @param startOffset Start address offset in bytes.
+	 * @param len Operation length in bytes.
+	 * @return No return value.
+	 */
+	inline void observeEnd(uint8_t op, uint32_t t0, uint16_t startOffset = 0, uint32_t len = 0)
+	{
+		#if defined(SEEPROM_OBSERVER) || defined(SEEPROM_TRACE)
+		uint32_t ticks = timestamp() - t0;
+		#else
+		(void)t0;
+		#endif
+
+		#ifdef SEEPROM_OBSERVER
+		SEEPROM_OBSERVER::end(op, ticks);
+		#endif // SEEPROM_OBSERVER
+
+		#ifdef SEEPROM_TRACE
+		if (op != SEEPROM_OP_UNLOCK) sEEPROMTrace::record(op, start - SEEPROM_START + startOffset, len, ticks);
+		#else
+		(void)op;
+		(void)startOffset;
+		(void)len;
+		#endif // SEEPROM_TRACE
+	}
+
+	/**
+	 * @brief Wait for issued word program to complete and report its duration to observer.
+	 * 
+	 * Does nothing without \c SEEPROM_OBSERVER.
+	 * 
+	 * @param t0 Word program start timestamp.
+	 * @return No return value.
+	 */
+	static inline void observeProgram(uint32_t t0)
+	{
+		#ifdef SEEPROM_OBSERVER
+		while (FLASH->SR & FLASH_SR_BSY);
+		SEEPROM_OBSERVER::program(timestamp() - t0);
+		#else
+		(void)t0;
+		#endif // SEEPROM_OBSERVER
+	}
+
+	/**
+	 * @brief Wear accounting point.
+	 * 
+	 * Called after each word program or erase operation. Compiles to nothing without \c SEEPROM_WEAR.
+	 * 
+	 * @param addr Pointer to programmed EEPROM location.
+	 * @return No return value.
+	 */
+	static inline void wearPoint(const void* addr)
+	{
+		#ifdef SEEPROM_WEAR
+		sEEPROMWear::record((uint32_t)(uintptr_t)addr);
+		#else
+		(void)addr;
+		#endif // SEEPROM_WEAR
+	}
+
+	/**
+	 * @brief Trace point.
+	 * 
+	 * Called before each word program or erase operation. Compiles to nothing without \c SEEPROM_TRACE.
+	 * 
+	 * @param addr Pointer to EEPROM location.
+	 * @param changed Location gets new value.
+	 * @return No return value.
+	 */
+	static inline void tracePoint(const void* addr, bool changed)
+	{
+		#ifdef SEEPROM_TRACE
+		if (changed) sEEPROMTrace::mark((uint32_t)(uintptr_t)addr);
+		#else
+		(void)addr;
+		(void)changed;
+		#endif // SEEPROM_TRACE
+	}
+
+	/**
+	 * @brief Fault injection point.
+	 * 
+	 * Called before and after each word program or erase operation. Compiles to nothing without \c SEEPROM_FAULT_INJECTION.
+	 * 
+	 * @param issued Operation is issued.
+	 * @return No return value.
+	 */
+	static inline void faultPoint(uint8_t issued)
+	{
+		#ifdef SEEPROM_FAULT_INJECTION
+		if (faultOp != 1)
+		{
+			if (issued && faultOp) faultOp--;
+			return;
+		}
+
+		// Cut power
+		if (issued == faultTorn) NVIC_SystemReset();
+		#else
+		(void)issued;
+		#endif // SEEPROM_FAULT_INJECTION
+	}
+
+	/**
+	 * @brief Take FLASH controller.
+	 * 
+	 * @return No return value.
+	 */
+	inline void takeController(void)
+	{
+		if (mutexTake) mutexTake();
+	}
+
+	/**
+	 * @brief Give FLASH controller back.
+	 * 
+	 * @return No return value.
+	 */
+	inline void giveController(void)
+	{
+		if (mutexGive) mutexGive();
+	}
+
+	/**
+	 * @brief Unlock write access to EEPROM and PECR register.
+	 * 
+	 * @return No return value.
+	 */
+	inline void unlockEEPROM(void)
+	{
+		uint32_t t0 = observeBegin(SEEPROM_OP_UNLOCK);
+
+		// Wait if flash is busy
+		waitBusy();
+
+		// Write required values to unlock EEPROM and PECR
+		writeKeys();
+
+		observeEnd(SEEPROM_OP_UNLOCK, t0);
+	}
+
+	/**
+	 * @brief Write PEKEYR unlock sequence with interrupts masked.
+	 * 
+	 * Interrupt between both keys could run \ref writeUrgent, which sees PECR still locked and writes its own keys. Wrong key order locks PECR until reset.
+	 * 
+	 * @return No return value.
+	 */
+	static inline void writeKeys(void)
+	{
+		uint32_t mask = __get_PRIMASK();
+		__disable_irq();
+
+		FLASH->PEKEYR = PEKEY_VALUE_1;
+		FLASH->PEKEYR = PEKEY_VALUE_2;
+
+		if (!mask) __enable_irq();
+	}
+
+	/**
+	 * @brief Alias for \ref unlockEEPROM
+	 * 
+	 * @return No return value.
+	 */
+	inline void unlockPECR(void)
+	{
+		unlockEEPROM();
+	}
+
+	/**
+	 * @brief Lock write access to EEPROM and PECR register.
+	 * 
+	 * @return No return value.
+	 */
+	inline void lockEEPROM(void)
+	{
+		// Wait if flash is busy
+		waitBusy();
+
+		// Lock EEPROM and PECR by writing 1 to PELOCK bit
+		FLASH->PECR |= FLASH_PECR_PELOCK;
+	}
+
+	/**
+	 * @brief Alias for \ref lockEEPROM
+	 * 
+	 * @return No return value.
+	 */
+	inline void lockPECR(void)
+	{
+		lockEEPROM();
+	}
+};
+
+/**
+ * @brief Queue of pending EEPROM writes.
+ * 
+ * Write descriptors with payload are stored inline in queue, so \ref submit takes constant time and can be called from interrupt handler.
+ * Writes are executed by \ref process from main loop(or FLASH interrupt handler).
+ * 
+ * @tparam slots Number of queue slots. Must be power of 2 and not larger than 128.
+ * @tparam size Maximum payload size of one write in bytes.
+ */
+template<uint8_t slots, uint8_t size>
+class sEEPROMQueue {
+	static_assert(slots && slots <= 128 && !(slots & (slots - 1)), "sEEPROMQueue: Number of slots must be power of 2 and not larger than 128!");
+
+	// PUBLIC STUFF
+	public:
+	// METHOD DEFINITIONS
+	/**
+	 * @brief Submit write from single producer.
+	 * 
+	 * Lock-free. Use it when only one context(eg., one interrupt handler) submits writes to this queue.
+	 * 
+	 * @param eeprom Pointer to EEPROM object.
+	 * @param startOffset Start address offset in bytes.
+	 * @param value Pointer to input values to write.
+	 * @param len Length of \c value in bytes.
+	 * @return \c SEEPROM_NOK if queue is full.
+	 * @return \c SEEPROM_OF if \c len is larger than slot payload size.
+	 * @return \c SEEPROM_OK if write is submitted.
+	 */
+	uint8_t submit(sEEPROM* eeprom, uint16_t startOffset, const void* value, uint8_t len)
+	{
+		if (len > size) return SEEPROM_OF;
+		if ((uint8_t)(head - tail) == slots) return SEEPROM_NOK;
+
+		// Fill descriptor and publish it
+		fill(items[head & (slots - 1)], eeprom, startOffset, value, len);
+		head++;
+
+		return SEEPROM_OK;
+	}
+
+	/**
+	 * @brief Submit write from multiple producers.
+	 * 
+	 * Slot is reserved with interrupts masked for few instructions, payload is copied with interrupts enabled.
+	 * Do not mix with \ref submit on same queue.
+	 * 
+	 * @param eeprom Pointer to EEPROM object.
+	 * @param startOffset Start address offset in bytes.
+	 * @param value Pointer to input values to write.
+	 * @param len Length of \c value in bytes.
+	 * @return \c SEEPROM_NOK if queue is full.
+	 * @return \c SEEPROM_OF if \c len is larger than slot payload size.
+	 * @return \c SEEPROM_OK if write is submitted.
+	 */
+	uint8_t submitMulti(sEEPROM* eeprom, uint16_t startOffset, const void* value, uint8_t len)
+	{
+		if (len > size) return SEEPROM_OF;
+
+		// Reserve slot
+		uint32_t mask = __get_PRIMASK();
+		__disable_irq();
+
+		if ((uint8_t)(head - tail) == slots)
+		{
+			if (!mask) __enable_irq();
+			return SEEPROM_NOK;
+		}
+
+		uint8_t idx = head;
+		head = idx + 1;
+
+		if (!mask) __enable_irq();
+
+		// Fill descriptor and publish it
+		fill(items[idx & (slots - 1)], eeprom, startOffset, value, len);
+
+		return SEEPROM_OK;
+	}
+
+	/**
+	 * @brief Execute pending writes.
+	 * 
+	 * Must be called from only one context.
+	 * 
+	 * @param max Maximum number of writes to execute.
+	 * @return Number of executed writes.
+	 */
+	uint8_t process(uint8_t max = slots)
+	{
+		uint8_t cnt = 0;
+
+		while (cnt != max && tail != head)
+		{
+			item& it = items[tail & (slots - 1)];
+
+			// Stop at descriptor which is still being filled
+			if (!it.ready) break;
+
+			// Write payload
+			it.eeprom->write(it.offset, it.data, it.len);
+
+			// Release slot
+			it.ready = 0;
+			__DMB();
+			tail++;
+			cnt++;
+		}
+
+		return cnt;
+	}
+
+	/**
+	 * @brief Get number of pending writes.
+	 * 
+	 * @return Number of pending writes.
+	 */
+	inline uint8_t pending(void) const
+	{
+		return (uint8_t)(head - tail);
+	}
+
+
+	// PRIVATE STUFF
+	private:
+	// STRUCTS
+	/**
+	 * @brief Write descriptor.
+	 * 
+	 */
+	struct item {
+		sEEPROM* eeprom; /**< @brief Pointer to EEPROM object. */
+		uint16_t offset; /**< @brief Start address offset in bytes. */
+		uint8_t len; /**< @brief Payload length in bytes. */
+		volatile uint8_t ready = 0; /**< @brief Descriptor is filled. */
+		uint8_t data[size]; /**< @brief Payload. */
+	};
+
+	// VARIABLES
+	item items[slots]; /**< @brief Queue slots. */
+	volatile uint8_t head = 0; /**< @brief Free running index of next free slot. */
+	volatile uint8_t tail = 0; /**< @brief Free running index of oldest pending slot. */
+
+	// METHOD DEFINITIONS
+	/**
+	 * @brief Fill write descriptor and mark it as ready.
+	 * 
+	 * @param it Reference to descriptor.
+	 * @param eeprom Pointer to EEPROM object.
+	 * @param startOffset Start address offset in bytes.
+	 * @param value Pointer to payload.
+	 * @param len Length of \c value in bytes.
+	 * @return No return value.
+	 */
+	inline void fill(item& it, sEEPROM* eeprom, uint16_t startOffset, const void* value, uint8_t len)
+	{
+		it.eeprom = eeprom;
+		it.offset = startOffset;
+		it.len = len;
+
+		for (uint8_t i = 0; i < len; i++) it.data[i] = ((const uint8_t*)value)[i];
+
+		// Descriptor must be complete before it is visible to consumer
+		__DMB();
+		it.ready = 1;
+		__DMB();
+	}
+};
+
+
+/**
+ * @brief Buffered EEPROM stream writer.
+ * 
+ * Bytes are collected in word aligned buffer and only full aligned words are written to EEPROM.
+ * Partial head and tail words are padded with current EEPROM content, so no byte or half-word writes are made.
+ * Area length does not need to be multiple of 4.
+ */
+class sEEPROMWriter {
+	static_assert(SEEPROM_STREAM_BUFFER && !(SEEPROM_STREAM_BUFFER % 4), "sEEPROM: SEEPROM_STREAM_BUFFER must be multiple of 4!");
+
+	// PUBLIC STUFF
+	public:
+	// OBJECT CONSTRUCTORS AND DECONSTRUCTORS
+	/**
+	 * @brief Object constructor.
+	 * 
+	 * @param eeprom Reference to EEPROM object.
+	 * @param startOffset Start address offset in bytes.
+	 * @return No return value.
+	 */
+	sEEPROMWriter(sEEPROM& eeprom, uint16_t startOffset);
+
+	/**
+	 * @brief Object deconstructor.
+	 * 
+	 * Writes buffered bytes to EEPROM.
+	 * 
+	 * @return No return value.
+	 */
+	~sEEPROMWriter(void);
+
+
+	// METHOD DECLARATIONS
+	/**
+	 * @brief Append \c len bytes to stream.
+	 * 
+	 * @param value Pointer to input values to write.
+	 * @param len Length of \c value in bytes.
+	 * @return \c SEEPROM_NOK if stream is closed.
+	 * @return \c SEEPROM_OF if writing \c len bytes will overflow defined area.
+	 * @return Other return code of \ref sEEPROM::write if buffer flush fails.
+	 * @return \c SEEPROM_OK if bytes are appended.
+	 */
+	uint8_t write(const void* value, uint16_t len);
+
+	/**
+	 * @brief Write buffered bytes to EEPROM and close stream.
+	 * 
+	 * @return \c SEEPROM_NOK if stream is already closed.
+	 * @return Other return code of \ref sEEPROM::write if buffered bytes are not written. Stream is closed anyway.
+	 * @return \c SEEPROM_OK if stream is closed.
+	 */
+	uint8_t close(void);
+
+	/**
+	 * @brief Get stream cursor.
+	 * 
+	 * @return Offset of next byte in bytes.
+	 */
+	inline uint16_t tell(void) const
+	{
+		return base + fill;
+	}
+
+
+	// PRIVATE STUFF
+	private:
+	// VARIABLES
+	sEEPROM* eeprom = nullptr; /**< @brief Pointer to EEPROM object. */
+	uint16_t base = 0; /**< @brief Aligned offset of first buffer byte. */
+	uint8_t fill = 0; /**< @brief Number of bytes in buffer. */
+	uint8_t open = 1; /**< @brief Stream is open. */
+	uint32_t buffer[SEEPROM_STREAM_BUFFER / 4]; /**< @brief Word aligned buffer. */
+
+	// METHOD DECLARATIONS
+	/**
+	 * @brief Write buffered words to EEPROM.
+	 * 
+	 * @return Return code of \ref sEEPROM::write.
+	 */
+	uint8_t flush(void);
+};
+
+/**
+ * @brief EEPROM stream reader.
+ * 
+ */
+class sEEPROMReader {
+	// PUBLIC STUFF
+	public:
+	// OBJECT CONSTRUCTORS AND DECONSTRUCTORS
+	/**
+	 * @brief Object constructor.
+	 * 
+	 * @param eeprom Reference to EEPROM object.
+	 * @param startOffset Start address offset in bytes.
+	 * @return No return value.
+	 */
+	sEEPROMReader(sEEPROM& eeprom, uint16_t startOffset);
+
+
+	// METHOD DECLARATIONS
+	/**
+	 * @brief Read \c len bytes from stream.
+	 * 
+	 * @param output Pointer to output array.
+	 * @param len Size of \c output array in bytes.
+	 * @return \c SEEPROM_OF if reading \c len bytes will go outside defined area.
+	 * @return \c SEEPROM_OK if read is successful.
+	 */
+	uint8_t read(void* output, uint16_t len);
+
+	/**
+	 * @brief Move stream cursor.
+	 * 
+	 * @param offset New cursor offset in bytes.
+	 * @return No return value.
+	 */
+	inline void seek(uint16_t offset)
+	{
+		cursor = offset;
+	}
+
+	/**
+	 * @brief Get stream cursor.
+	 * 
+	 * @return Offset of next byte in bytes.
+	 */
+	inline uint16_t tell(void) const
+	{
+		return cursor;
+	}
+
+
+	// PRIVATE STUFF
+	private:
+	// VARIABLES
+	sEEPROM* eeprom = nullptr; /**< @brief Pointer to EEPROM object. */
+	uint16_t cursor = 0; /**< @brief Offset of next byte. */
+};
+
+
+/**
+ * @brief SECDED ECC layer for EEPROM words.
+ * 
+ * Each data word is protected by 7 check bits of Hsiao(39,32) code stored as one byte per word in separate check area.
+ * Single bit errors are corrected and double bit errors are detected on read. Corrected words are written back by \ref repair.
+ * Erased EEPROM(all zeros) is valid codeword. Encode and decode are four table lookups per word.
+ * Word update sets check byte to \c SEEPROM_ECC_OPEN first, writes data word and writes check bits with commit bit(\c SEEPROM_ECC_COMMIT) last. Word with cleared commit bit is reported as uncorrectable unless word and check byte are erased, so update interrupted by power loss is never corrected to wrong data.
+ */
+class sEEPROMECC {
+	// PUBLIC STUFF
+	public:
+	// OBJECT CONSTRUCTORS AND DECONSTRUCTORS
+	/**
+	 * @brief Object constructor.
+	 * 
+	 * @param data Reference to EEPROM object with data words.
+	 * @param check Reference to EEPROM object with check bytes. Must be at least quarter of \c data length.
+	 * @return No return value.
+	 */
+	sEEPROMECC(sEEPROM& data, sEEPROM& check);
+
+
+	// METHOD DECLARATIONS
+	/**
+	 * @brief Read and correct \c len bytes.
+	 * 
+	 * @param startOffset Start address offset in bytes. Must be aligned by 4 bytes.
+	 * @param output Pointer to word aligned output array.
+	 * @param len Size of \c output array in bytes. Must be multiple of 4.
+	 * @return \c SEEPROM_NOK if \c startOffset or \c len is not aligned by 4 bytes.
+	 * @return \c SEEPROM_OF if reading \c len bytes will go outside defined area.
+	 * @return \c SEEPROM_ECC if at least one word has uncorrectable error.
+	 * @return \c SEEPROM_OK if read is successful.
+	 */
+	uint8_t read(uint16_t startOffset, void* output, uint16_t len);
+
+	/**
+	 * @brief Write \c len bytes with check bytes.
+	 * 
+	 * Every 16 words take two check byte writes and one data write. Interrupted words read back as \c SEEPROM_ECC or as their old or new value.
+	 * 
+	 * @param startOffset Start address offset in bytes. Must be aligned by 4 bytes.
+	 * @param value Pointer to word aligned input array.
+	 * @param len Length of \c value in bytes. Must be multiple of 4.
+	 * @return \c SEEPROM_NOK if \c startOffset or \c len is not aligned by 4 bytes.
+	 * @return \c SEEPROM_OF if writing \c len bytes will overflow defined area.
+	 * @return \c SEEPROM_OK if write is successful.
+	 */
+	uint8_t write(uint16_t startOffset, const void* value, uint16_t len);
+
+	/**
+	 * @brief Write back words corrected by \ref read.
+	 * 
+	 * @return Number of repaired words.
+	 */
+	uint8_t repair(void);
+
+	/**
+	 * @brief Get number of corrected words waiting for \ref repair.
+	 * 
+	 * @return Number of pending words.
+	 */
+	inline uint8_t pending(void) const
+	{
+		return pendingCnt;
+	}
+
+	/**
+	 * @brief Get length of protected data.
+	 * 
+	 * @return Data length in bytes.
+	 */
+	inline uint16_t size(void) const
+	{
+		return data->size();
+	}
+
+
+	// STATIC METHOD DECLARATIONS
+	/**
+	 * @brief Encode check bits.
+	 * 
+	 * @param word Data word.
+	 * @return Check bits.
+	 */
+	static uint8_t encode(uint32_t word);
+
+	/**
+	 * @brief Decode and correct word.
+	 * 
+	 * @param word Reference to data word. Corrected in place.
+	 * @param check Reference to check byte. Corrected in place.
+	 * @return \c SEEPROM_NOK if error was corrected.
+	 * @return \c SEEPROM_ECC if error is uncorrectable or word update is not committed.
+	 * @return \c SEEPROM_OK if word has no error.
+	 */
+	static uint8_t decode(uint32_t& word, uint8_t& check);
+
+
+	// PRIVATE STUFF
+	private:
+	// VARIABLES
+	sEEPROM* data = nullptr; /**< @brief Pointer to EEPROM object with data words. */
+	sEEPROM* check = nullptr; /**< @brief Pointer to EEPROM object with check bytes. */
+	uint16_t pendingWords[SEEPROM_ECC_PENDING]; /**< @brief Offsets of corrected words. */
+	uint8_t pendingCnt = 0; /**< @brief Number of corrected words. */
+};
+
+
+/**
+ * @brief Incremental EEPROM scrubber.
+ * 
+ * Reads data through \ref sEEPROMECC in bounded slices, writes back corrected words and stores scrub cursor to EEPROM once per block, so scrubbing continues where it stopped after reboot.
+ */
+class sEEPROMScrub {
+	// PUBLIC STUFF
+	public:
+	// OBJECT CONSTRUCTORS AND DECONSTRUCTORS
+	/**
+	 * @brief Object constructor.
+	 * 
+	 * @param ecc Reference to ECC layer to scrub.
+	 * @param state Reference to EEPROM object with scrub state word.
+	 * @param stateOffset Scrub state word offset in bytes. Must be aligned by 4 bytes.
+	 * @param blockLen Block length in bytes. Scrub state is stored when block is done. Rounded down to multiple of 4, \c 0 to \c 3 selects one word.
+	 * @return No return value.
+	 */
+	sEEPROMScrub(sEEPROMECC& ecc, sEEPROM& state, uint16_t stateOffset, uint16_t blockLen);
+
+
+	// METHOD DECLARATIONS
+	/**
+	 * @brief Load scrub state from EEPROM.
+	 * 
+	 * @return No return value.
+	 */
+	void load(void);
+
+	/**
+	 * @brief Scrub next \c words words.
+	 * 
+	 * Worst case blocking time is \c words word reads plus three word programs for each corrected word.
+	 * 
+	 * @param words Maximum number of words to scrub.
+	 * @return \c SEEPROM_ECC if uncorrectable word is found in this slice.
+	 * @return \c SEEPROM_OK if slice is scrubbed.
+	 */
+	uint8_t step(uint16_t words);
+
+	/**
+	 * @brief Get scrub cursor.
+	 * 
+	 * @return Offset of next word to scrub in bytes.
+	 */
+	inline uint16_t position(void) const
+	{
+		return cursor;
+	}
+
+	/**
+	 * @brief Get number of completed scrub passes.
+	 * 
+	 * @return Number of passes.
+	 */
+	inline uint16_t passes(void) const
+	{
+		return passCnt;
+	}
+
+	/**
+	 * @brief Get number of repaired words since object construction.
+	 * 
+	 * @return Number of repaired words.
+	 */
+	inline uint16_t repaired(void) const
+	{
+		return repairCnt;
+	}
+
+	/**
+	 * @brief Get number of uncorrectable words found since object construction.
+	 * 
+	 * @return Number of uncorrectable words.
+	 */
+	inline uint16_t errors(void) const
+	{
+		return errorCnt;
+	}
+
+
+	// PRIVATE STUFF
+	private:
+	// VARIABLES
+	sEEPROMECC* ecc = nullptr; /**< @brief Pointer to ECC layer. */
+	sEEPROM* state = nullptr; /**< @brief Pointer to EEPROM object with scrub state word. */
+	uint16_t stateOffset = 0; /**< @brief Scrub state word offset in bytes. */
+	uint16_t blockLen = 0; /**< @brief Block length in bytes. */
+	uint16_t cursor = 0; /**< @brief Offset of next word to scrub. */
+	uint16_t passCnt = 0; /**< @brief Number of completed passes. */
+	uint16_t repairCnt = 0; /**< @brief Number of repaired words. */
+	uint16_t errorCnt = 0; /**< @brief Number of uncorrectable words. */
+
+	// METHOD DECLARATIONS
+	/**
+	 * @brief Store scrub state to EEPROM.
+	 * 
+	 * @return No return value.
+	 */
+	void save(void);
+};
+
+
+/**
+ * @brief Wear spreading persistent counter.
+ * 
+ * Counter value is written to next slot in ring of slots on every update, so endurance of counter is multiplied by number of slots.
+ * Slot holds counter value followed by CRC-32 word of value. Slot values increase along the ring, so last written slot is found by binary search on mount.
+ * If update is torn, slot fails CRC check and is skipped on mount, so counter holds value before or after torn update.
+ * Counter must not overflow.
+ * 
+ * @tparam T Counter type. \c uint32_t or \c uint64_t.
+ */
+template<typename T>
+class sEEPROMCounter {
+	static_assert(sizeof(T) == 4 || sizeof(T) == 8, "sEEPROMCounter: Counter type must be 32 or 64 bit!");
+
+	// PUBLIC STUFF
+	public:
+	// OBJECT CONSTRUCTORS AND DECONSTRUCTORS
+	/**
+	 * @brief Object constructor.
+	 * 
+	 * @param eeprom Reference to EEPROM object used for slot ring. Start address must be aligned by 4 bytes.
+	 * @return No return value.
+	 */
+	sEEPROMCounter(sEEPROM& eeprom)
+	{
+		this->eeprom = &eeprom;
+		slots = eeprom.size() / slotSize;
+	}
+
+
+	// METHOD DEFINITIONS
+	/**
+	 * @brief Find last written slot.
+	 * 
+	 * Takes O(log n) slot reads.
+	 * 
+	 * @return \c SEEPROM_NOK if EEPROM area is smaller than one slot.
+	 * @return \c SEEPROM_OK if counter is mounted.
+	 */
+	uint8_t mount(void)
+	{
+		if (!slots) return SEEPROM_NOK;
+
+		// Torn first slot is followed by slots of previous lap
+		T first = 0;
+		uint16_t lo = 0;
+		if (!slot(0, first))
+		{
+			lo = 1;
+
+			// Blank ring, first increment writes slot 0
+			if (slots < 2 || !slot(1, first))
+			{
+				last = slots - 1;
+				current = 0;
+
+				return SEEPROM_OK;
+			}
+		}
+
+		uint16_t hi = slots;
+
+		// Find last valid slot with value not smaller than first slot
+		while ((hi - lo) > 1)
+		{
+			uint16_t mid = lo + ((hi - lo) / 2);
+			T val;
+
+			if (slot(mid, val) && val >= first) lo = mid;
+			else hi = mid;
+		}
+
+		last = lo;
+		slot(lo, current);
+
+		return SEEPROM_OK;
+	}
+
+	/**
+	 * @brief Get counter value.
+	 * 
+	 * @return Counter value.
+	 */
+	inline T value(void) const
+	{
+		return current;
+	}
+
+	/**
+	 * @brief Increment counter.
+	 * 
+	 * @param step Increment step. Must not be \c 0.
+	 * @return \c SEEPROM_NOK if counter is not mounted or \c step is \c 0.
+	 * @return \c SEEPROM_OK if counter is incremented.
+	 */
+	uint8_t increment(T step = 1)
+	{
+		if (!slots || !step) return SEEPROM_NOK;
+
+		uint16_t next = (last + 1) % slots;
+		T val = current + step;
+		uint32_t buf[slotSize / 4];
+
+		buf[0] = (uint32_t)val;
+		if (sizeof(T) == 8) buf[1] = (uint32_t)((uint64_t)val >> 32);
+		buf[sizeof(T) / 4] = sEEPROMCRC::crc32(buf, sizeof(T));
+
+		uint8_t ret = eeprom->write(next * slotSize, buf, slotSize);
+		if (ret != SEEPROM_OK) return ret;
+
+		last = next;
+		current = val;
+
+		return SEEPROM_OK;
+	}
+
+
+	// PRIVATE STUFF
+	private:
+	// STATIC VARIABLES
+	static constexpr uint16_t slotSize = sizeof(T) + 4; /**< @brief Slot size in bytes: value and its CRC-32. */
+
+	// VARIABLES
+	sEEPROM* eeprom = nullptr; /**< @brief Pointer to EEPROM object. */
+	uint16_t slots = 0; /**< @brief Number of slots. */
+	uint16_t last = 0; /**< @brief Index of last written slot. */
+	T current = 0; /**< @brief Counter value. */
+
+	// METHOD DEFINITIONS
+	/**
+	 * @brief Read slot value.
+	 * 
+	 * @param idx Slot index.
+	 * @param val Reference to output slot value.
+	 * @return \c true if slot CRC is valid.
+	 */
+	inline bool slot(uint16_t idx, T& val)
+	{
+		uint32_t buf[slotSize / 4] = { 0 };
+		eeprom->read(idx * slotSize, buf, slotSize);
+		val = (T)((uint64_t)buf[0] | ((sizeof(T) == 8) ? ((uint64_t)buf[1] << 32) : 0));
+
+		return buf[sizeof(T) / 4] == sEEPROMCRC::crc32(buf, sizeof(T));
+	}
+};
+
+
+/**
+ * @brief Persistent FIFO queue with variable length entries.
+ * 
+ * Entries are stored in ring as two word header(sequence number, length with check) followed by word padded payload.
+ * Payload is written before header, so torn push leaves no valid entry. Popped entries are marked as consumed by rewriting second header word.
+ * There are no head and tail pointers in EEPROM, queue state is recovered by scanning entry headers in \ref mount.
+ */
+class sEEPROMFIFO {
+	// PUBLIC STUFF
+	public:
+	// OBJECT CONSTRUCTORS AND DECONSTRUCTORS
+	/**
+	 * @brief Object constructor.
+	 * 
+	 * @param eeprom Reference to EEPROM object used for queue. Start address and length must be aligned by 4 bytes.
+	 * @return No return value.
+	 */
+	sEEPROMFIFO(sEEPROM& eeprom);
+
+
+	// METHOD DECLARATIONS
+	/**
+	 * @brief Recover queue state from entry headers.
+	 * 
+	 * @return No return value.
+	 */
+	void mount(void);
+
+	/**
+	 * @brief Push entry to queue.
+	 * 
+	 * @param value Pointer to entry payload.
+	 * @param len Payload length in bytes.
+	 * @return \c SEEPROM_NOK if there is not enough free space.
+	 * @return \c SEEPROM_OK if entry is pushed.
+	 */
+	uint8_t push(const void* value, uint16_t len);
+
+	/**
+	 * @brief Read oldest entry without removing it.
+	 * 
+	 * @param output Pointer to output array.
+	 * @param size Size of \c output array in bytes.
+	 * @param len Reference to output entry length in bytes.
+	 * @return \c SEEPROM_NOK if queue is empty.
+	 * @return \c SEEPROM_OF if entry is larger than \c size.
+	 * @return \c SEEPROM_OK if entry is read.
+	 */
+	uint8_t peek(void* output, uint16_t size, uint16_t& len);
+
+	/**
+	 * @brief Read and remove oldest entry.
+	 * 
+	 * @param output Pointer to output array.
+	 * @param size Size of \c output array in bytes.
+	 * @param len Reference to output entry length in bytes.
+	 * @return \c SEEPROM_NOK if queue is empty.
+	 * @return \c SEEPROM_OF if entry is larger than \c size. Entry is not removed.
+	 * @return \c SEEPROM_OK if entry is removed.
+	 */
+	uint8_t pop(void* output, uint16_t size, uint16_t& len);
+
+	/**
+	 * @brief Read and remove as many oldest entries as fit in \c output.
+	 * 
+	 * Each entry is stored in \c output as 16-bit length followed by payload.
+	 * 
+	 * @param output Pointer to output array.
+	 * @param size Size of \c output array in bytes.
+	 * @param used Reference to number of used \c output bytes.
+	 * @return Number of removed entries.
+	 */
+	uint16_t popBatch(void* output, uint16_t size, uint16_t& used);
+
+	/**
+	 * @brief Get number of entries in queue.
+	 * 
+	 * @return Number of entries.
+	 */
+	inline uint16_t count(void) const
+	{
+		return entries;
+	}
+
+
+	// PRIVATE STUFF
+	private:
+	// VARIABLES
+	sEEPROM* eeprom = nullptr; /**< @brief Pointer to EEPROM object. */
+	uint32_t nextSeq = 1; /**< @brief Sequence number of next pushed entry. */
+	uint16_t head = 0; /**< @brief Offset for next pushed entry. */
+	uint16_t tail = 0; /**< @brief Offset of oldest entry. */
+	uint16_t entries = 0; /**< @brief Number of entries. */
+
+	// METHOD DECLARATIONS
+	/**
+	 * @brief Read and validate entry header.
+	 * 
+	 * @param offset Header offset in bytes.
+	 * @param seq Reference to output sequence number.
+	 * @param len Reference to output payload length.
+	 * @param consumed Reference to output consumed flag.
+	 * @return \c true if header is valid.
+	 * @return \c false if there is no valid header at \c offset.
+	 */
+	bool header(uint16_t offset, uint32_t& seq, uint16_t& len, uint8_t& consumed);
+
+	/**
+	 * @brief Remove oldest entry.
+	 * 
+	 * @param len Oldest entry payload length in bytes.
+	 * @return No return value.
+	 */
+	void remove(uint16_t len);
+
+	// STATIC METHOD DECLARATIONS
+	/**
+	 * @brief Calculate header check.
+	 * 
+	 * Check is folded CRC-32, so second header word followed by payload word does not form valid header.
+	 * 
+	 * @param seq Sequence number.
+	 * @param len Payload length in bytes.
+	 * @param consumed Consumed flag.
+	 * @return Header check.
+	 */
+	static inline uint16_t check(uint32_t seq, uint16_t len, uint8_t consumed)
+	{
+		uint32_t key[2] = { seq, len };
+		uint32_t crc = sEEPROMCRC::crc32(key, 6);
+
+		return ~((crc >> 16) ^ crc ^ (consumed ? 0xA5A5 : 0x0000));
+	}
+
+	/**
+	 * @brief Calculate entry size in EEPROM.
+	 * 
+	 * @param len Payload length in bytes.
+	 * @return Entry size in bytes.
+	 */
+	static inline uint16_t entrySize(uint16_t len)
+	{
+		return 8 + ((len + 3) & ~0x3);
+	}
+};
+
+
+/**
+ * @brief Per priority lane statistics of \ref sEEPROMScheduler.
+ * 
+ * Times are in \c SEEPROM_TIMESTAMP ticks and are \c 0 if \c SEEPROM_TIMESTAMP is not defined.
+ */
+struct sEEPROMLaneStats {
+	uint32_t done = 0; /**< @brief Number of finished writes. */
+	uint32_t waitSum = 0; /**< @brief Sum of queueing latencies(submit to first word program). */
+	uint32_t waitMax = 0; /**< @brief Longest queueing latency. */
+	uint32_t totalMax = 0; /**< @brief Longest latency from submit to finished write. */
+};
+
+/**
+ * @brief Prioritised EEPROM write scheduler.
+ * 
+ * Writes are queued in \c SEEPROM_PRIO_COUNT priority lanes and executed one word program at a time, so write submitted to higher priority lane preempts running lower priority write at next word boundary.
+ * Payload is not copied and must stay valid until write is finished.
+ * 
+ * @tparam slots Number of queue slots per lane. Must be power of 2 and not larger than 128.
+ */
+template<uint8_t slots>
+class sEEPROMScheduler {
+	static_assert(slots && slots <= 128 && !(slots & (slots - 1)), "sEEPROMScheduler: Number of slots must be power of 2 and not larger than 128!");
+
+	// PUBLIC STUFF
+	public:
+	// METHOD DEFINITIONS
+	/**
+	 * @brief Submit write to priority lane.
+	 * 
+	 * Only one context may submit to one lane.
+	 * 
+	 * @param prio Priority lane. \c 0 is highest priority.
+	 * @param eeprom Pointer to EEPROM object.
+	 * @param startOffset Start address offset in bytes.
+	 * @param value Pointer to input values to write.
+	 * @param len Length of \c value in bytes.
+	 * @return \c SEEPROM_NOK if \c prio is invalid or lane is full.
+	 * @return \c SEEPROM_OF if writing \c len bytes will overflow defined area.
+	 * @return \c SEEPROM_OK if write is submitted.
+	 */
+	uint8_t submit(uint8_t prio, sEEPROM* eeprom, uint16_t startOffset, const void* value, uint16_t len)
+	{
+		if (prio >= SEEPROM_PRIO_COUNT) return SEEPROM_NOK;
+
+		lane& l = lanes[prio];
+		if ((uint8_t)(l.head - l.tail) == slots) return SEEPROM_NOK;
+
+		item& it = l.items[l.head & (slots - 1)];
+		uint8_t ret = eeprom->writeStart(it.job, startOffset, value, len);
+		if (ret != SEEPROM_OK) return ret;
+
+		it.eeprom = eeprom;
+		it.queued = timestamp();
+		it.started = 0;
+
+		// Publish request
+		__DMB();
+		l.head++;
+
+		return SEEPROM_OK;
+	}
+
+	/**
+	 * @brief Execute at most \c words word programs.
+	 * 
+	 * Highest priority pending write is selected before every word program.
+	 * 
+	 * @param words Maximum number of word programs.
+	 * @return \c SEEPROM_BUSY if writes are still pending.
+	 * @return \c SEEPROM_OK if all lanes are empty.
+	 */
+	uint8_t run(uint16_t words)
+	{
+		while (words)
+		{
+			// Select highest priority pending write
+			uint8_t prio = 0;
+			while (prio < SEEPROM_PRIO_COUNT && lanes[prio].head == lanes[prio].tail) prio++;
+			if (prio == SEEPROM_PRIO_COUNT) return SEEPROM_OK;
+
+			lane& l = lanes[prio];
+			item& it = l.items[l.tail & (slots - 1)];
+
+			if (!it.started)
+			{
+				uint32_t wait = timestamp() - it.queued;
+				l.stats.waitSum += wait;
+				if (wait > l.stats.waitMax) l.stats.waitMax = wait;
+				it.started = 1;
+			}
+
+			words--;
+			if (it.eeprom->writeStep(it.job, 1) == SEEPROM_BUSY) continue;
+
+			// Write is finished
+			uint32_t total = timestamp() - it.queued;
+			if (total > l.stats.totalMax) l.stats.totalMax = total;
+			l.stats.done++;
+
+			__DMB();
+			l.tail++;
+		}
+
+		return pending() ? SEEPROM_BUSY : SEEPROM_OK;
+	}
+
+	/**
+	 * @brief Get number of pending writes in all lanes.
+	 * 
+	 * @return Number of pending writes.
+	 */
+	uint16_t pending(void) const
+	{
+		uint16_t cnt = 0;
+		for (uint8_t prio = 0; prio < SEEPROM_PRIO_COUNT; prio++) cnt += (uint8_t)(lanes[prio].head - lanes[prio].tail);
+
+		return cnt;
+	}
+
+	/**
+	 * @brief Get priority lane statistics.
+	 * 
+	 * @param prio Priority lane.
+	 * @return Reference to lane statistics.
+	 */
+	inline const sEEPROMLaneStats& stats(uint8_t prio) const
+	{
+		return lanes[prio < SEEPROM_PRIO_COUNT ? prio : 0].stats;
+	}
+
+
+	// PRIVATE STUFF
+	private:
+	// STRUCTS
+	/**
+	 * @brief Queued write.
+	 * 
+	 */
+	struct item {
+		sEEPROM* eeprom; /**< @brief Pointer to EEPROM object. */
+		sEEPROMJob job; /**< @brief Chunked write handle. */
+		uint32_t queued; /**< @brief Submit timestamp. */
+		uint8_t started; /**< @brief First word is programmed. */
+	};
+
+	/**
+	 * @brief Priority lane.
+	 * 
+	 */
+	struct lane {
+		item items[slots]; /**< @brief Lane slots. */
+		volatile uint8_t head = 0; /**< @brief Free running index of next free slot. */
+		volatile uint8_t tail = 0; /**< @brief Free running index of oldest pending slot. */
+		sEEPROMLaneStats stats; /**< @brief Lane statistics. */
+	};
+
+	// VARIABLES
+	lane lanes[SEEPROM_PRIO_COUNT]; /**< @brief Priority lanes. */
+
+	// METHOD DEFINITIONS
+	/**
+	 * @brief Get timestamp.
+	 * 
+	 * @return Timestamp in ticks or \c 0 without \c SEEPROM_TIMESTAMP.
+	 */
+	static inline uint32_t timestamp(void)
+	{
+		#ifdef SEEPROM_TIMESTAMP
+		return SEEPROM_TIMESTAMP();
+		#else
+		return 0;
+		#endif // SEEPROM_TIMESTAMP
+	}
+};
+
+
+/**
+ * @brief RAM shadow of EEPROM area with prioritised emergency flush.
+ * 
+ * Writes are staged in RAM and marked dirty per word. \ref emergencyFlush programs as many dirty words as fit in time budget, highest priority first, eg., from PVD interrupt handler.
+ */
+class sEEPROMShadow {
+	// PUBLIC STUFF
+	public:
+	// OBJECT CONSTRUCTORS AND DECONSTRUCTORS
+	/**
+	 * @brief Object constructor.
+	 * 
+	 * @param eeprom Reference to EEPROM object. Start address and length must be aligned by 4 bytes.
+	 * @param shadow Pointer to RAM shadow array with \c eeprom length.
+	 * @param dirty Pointer to dirty bitmap array with one bit per EEPROM word.
+	 * @return No return value.
+	 */
+	sEEPROMShadow(sEEPROM& eeprom, uint32_t* shadow, uint32_t* dirty);
+
+
+	// METHOD DECLARATIONS
+	/**
+	 * @brief Load EEPROM content to RAM shadow and clear dirty words.
+	 * 
+	 * @return No return value.
+	 */
+	void load(void);
+
+	/**
+	 * @brief Read \c len bytes from RAM shadow.
+	 * 
+	 * @param startOffset Start address offset in bytes.
+	 * @param output Pointer to output array.
+	 * @param len Size of \c output array in bytes.
+	 * @return \c SEEPROM_OF if reading \c len bytes will go outside defined area.
+	 * @return \c SEEPROM_OK if read is successful.
+	 */
+	uint8_t read(uint16_t startOffset, void* output, uint16_t len);
+
+	/**
+	 * @brief Write \c len bytes to RAM shadow.
+	 * 
+	 * Changed words are marked dirty.
+	 * 
+	 * @param startOffset Start address offset in bytes.
+	 * @param value Pointer to input values to write.
+	 * @param len Length of \c value in bytes.
+	 * @return \c SEEPROM_OF if writing \c len bytes will overflow defined area.
+	 * @return \c SEEPROM_OK if write is successful.
+	 */
+	uint8_t write(uint16_t startOffset, const void* value, uint16_t len);
+
+	/**
+	 * @brief Set priority of EEPROM range for \ref emergencyFlush.
+	 * 
+	 * Words outside all ranges have priority \c 0. On overlap, last range set wins.
+	 * 
+	 * @param startOffset Start address offset in bytes.
+	 * @param len Range length in bytes.
+	 * @param prio Priority. Higher value is flushed first.
+	 * @return \c SEEPROM_NOK if all \c SEEPROM_SHADOW_RANGES ranges are used.
+	 * @return \c SEEPROM_OK if priority is set.
+	 */
+	uint8_t setPriority(uint16_t startOffset, uint16_t len, uint8_t prio);
+
+	/**
+	 * @brief Write all dirty words to EEPROM.
+	 * 
+	 * @return Number of written words.
+	 */
+	uint16_t flush(void);
+
+	/**
+	 * @brief Write dirty words to EEPROM within time budget.
+	 * 
+	 * Dirty words are written highest priority first with \ref sEEPROM::writeUrgent until \c us microseconds of \c SEEPROM_PROG_TIME_US word programs are used.
+	 * 
+	 * @param us Time budget in microseconds.
+	 * @param lost Reference to output number of dirty words which did not fit in budget.
+	 * @return Number of written words.
+	 */
+	uint16_t emergencyFlush(uint32_t us, uint16_t& lost);
+
+	/**
+	 * @brief Get number of dirty words.
+	 * 
+	 * @return Number of dirty words.
+	 */
+	uint16_t dirtyWords(void) const;
+
 
+	// PRIVATE STUFF
+	private:
+	// STRUCTS
+	/**
+	 * @brief Priority range.
+	 * 
+	 */
+	struct range {
+		uint16_t offset; /**< @brief Range start word. */
+		uint16_t words; /**< @brief Range length in words. */
+		uint8_t prio; /**< @brief Range priority. */
+	};
 
-// ----- DEFINES
-// ERROR CODES
-#define SEEPROM_NOK				0 /**< @brief Return code for not OK status. */
-#define SEEPROM_OK				1 /**< @brief Return code for OK status. */
-#define SEEPROM_OF				2 /**< @brief Return code for prevented overflow. */
+	// VARIABLES
+	sEEPROM* eeprom = nullptr; /**< @brief Pointer to EEPROM object. */
+	uint32_t* shadow = nullptr; /**< @brief Pointer to RAM shadow. */
+	uint32_t* dirty = nullptr; /**< @brief Pointer to dirty bitmap. */
+	range ranges[SEEPROM_SHADOW_RANGES]; /**< @brief Priority ranges. */
+	uint8_t rangeCnt = 0; /**< @brief Number of priority ranges. */
 
-// EEPROM
-#define SEEPROM_START			0x08080000 /**< @brief EEPROM start address. */
-#define SEEPROM_SIZE			2048 /**< @brief EEPROM size in bytes. */
-#define SEEPROM_END				(SEEPROM_START + SEEPROM_SIZE) /**< @brief EEPROM end address. */
+	// METHOD DECLARATIONS
+	/**
+	 * @brief Get priority of word.
+	 * 
+	 * @param word Word index.
+	 * @return Word priority.
+	 */
+	uint8_t priority(uint16_t word) const;
 
-// VALUES
-#define PEKEY_VALUE_1			0x89ABCDEF /**< @brief Value 1 to unlock EEPROM and PECR. */
-#define PEKEY_VALUE_2			0x02030405 /**< @brief Value 2 to unlock EEPROM and PECR. */
+	/**
+	 * @brief Write one dirty word and clear its dirty bit.
+	 * 
+	 * @param word Word index.
+	 * @return No return value.
+	 */
+	void commit(uint16_t word);
+
+	/**
+	 * @brief Check if word is dirty.
+	 * 
+	 * @param word Word index.
+	 * @return \c true if word is dirty.
+	 */
+	inline bool isDirty(uint16_t word) const
+	{
+		return dirty[word / 32] & (1UL << (word % 32));
+	}
+};
 
 
-// ----- CLASSES
 /**
- * @brief EEPROM class.
+ * @brief Crash dump writer and reader.
  * 
+ * Dump is written with \ref sEEPROM::writeUrgent, so it can be written from HardFault handler with interrupts disabled.
+ * Dump layout is marker word, tag word, length word, checksum word and dumped words. Marker is written last and words which already hold dumped value are skipped.
  */
-class sEEPROM {
+class sEEPROMCrash {
 	// PUBLIC STUFF
 	public:
-	// OBJECT CONSTRUCTORS AND DECONSTRUCTORS
+	// STATIC METHOD DECLARATIONS
 	/**
-	 * @brief Object constructor.
+	 * @brief Write crash dump.
 	 * 
-	 * @param s EEPROM start address.
-	 * @param len EEPROM length in bytes.
+	 * @param region Reference to EEPROM object reserved for crash dump. Start address must be aligned by 4 bytes.
+	 * @param tag Dump tag(eg., fault type or firmware version).
+	 * @param value Pointer to words to dump(eg., stacked exception frame followed by rest of stack).
+	 * @param len Number of words to dump. Dump is truncated to \c region length.
+	 * @return Number of dumped words.
+	 */
+	static uint16_t dump(sEEPROM& region, uint32_t tag, const uint32_t* value, uint16_t len);
+
+	/**
+	 * @brief Read crash dump.
+	 * 
+	 * @param region Reference to EEPROM object reserved for crash dump.
+	 * @param tag Reference to output dump tag.
+	 * @param output Pointer to output words.
+	 * @param size Size of \c output in words.
+	 * @param len Reference to output number of dumped words.
+	 * @return \c SEEPROM_NOK if there is no valid dump.
+	 * @return \c SEEPROM_OF if dump is larger than \c size words. \c len holds dump length.
+	 * @return \c SEEPROM_OK if dump is read.
+	 */
+	static uint8_t read(sEEPROM& region, uint32_t& tag, uint32_t* output, uint16_t size, uint16_t& len);
+
+	/**
+	 * @brief Invalidate crash dump.
+	 * 
+	 * @param region Reference to EEPROM object reserved for crash dump.
 	 * @return No return value.
 	 */
-	sEEPROM(uint32_t s, uint16_t len);
+	static void clear(sEEPROM& region);
 
+
+	// PRIVATE STUFF
+	private:
+	// STATIC METHOD DECLARATIONS
 	/**
-	 * @brief Object deconstructor.
+	 * @brief Write one word if it differs.
 	 * 
+	 * @param region Reference to EEPROM object.
+	 * @param word Word index.
+	 * @param value Word value.
 	 * @return No return value.
 	 */
-	~sEEPROM(void);
+	static void put(sEEPROM& region, uint16_t word, uint32_t value);
+
+	/**
+	 * @brief Calculate dump checksum.
+	 * 
+	 * @param tag Dump tag.
+	 * @param value Pointer to dumped words.
+	 * @param len Number of dumped words.
+	 * @return Checksum.
+	 */
+	static uint32_t checksum(uint32_t tag, const uint32_t* value, uint16_t len);
+};
 
 
+/**
+ * @brief Factory defaults overlay.
+ * 
+ * Default image lives in program flash. EEPROM area holds validity bitmap(one bit per word) followed by image sized data area.
+ * Words with cleared bit are read from default image, so erased EEPROM reads as defaults and first boot needs no EEPROM writes.
+ * Word is materialised in EEPROM only when its value is changed. Data word is written before its bitmap bit.
+ * Each bitmap word is kept in two copies which are written one after another and read as OR of both, so torn bitmap program cannot clear bits of other words.
+ */
+class sEEPROMDefaults {
+	// PUBLIC STUFF
+	public:
+	// OBJECT CONSTRUCTORS AND DECONSTRUCTORS
 	/**
-	 * @brief Read \c len bytes from EEPROM.
+	 * @brief Object constructor.
 	 * 
-	 * @param startOffset Start address offset in bytes.
+	 * @param eeprom Reference to EEPROM object. Must hold \ref overhead bytes plus \c len bytes. Start address must be aligned by 4 bytes.
+	 * @param defaults Pointer to default image(eg., \c static \c constexpr struct in program flash).
+	 * @param len Default image length in bytes.
+	 * @return No return value.
+	 */
+	sEEPROMDefaults(sEEPROM& eeprom, const void* defaults, uint16_t len);
+
+
+	// METHOD DECLARATIONS
+	/**
+	 * @brief Read \c len bytes of image.
+	 * 
+	 * @param startOffset Start offset in image in bytes.
 	 * @param output Pointer to output array.
 	 * @param len Size of \c output array in bytes.
-	 * @return \c SEEPROM_OF if reading \c len bytes will go outside defined area.
-	 * @return \c SEEPROM_OK is read is successful.
+	 * @return \c SEEPROM_OF if reading \c len bytes will go outside image or EEPROM area is too small.
+	 * @return \c SEEPROM_OK if read is successful.
 	 */
 	uint8_t read(uint16_t startOffset, void* output, uint16_t len);
 
 	/**
-	 * @brief Write \c len bytes to EEPROM.
+	 * @brief Write \c len bytes of image.
 	 * 
-	 * @param startOffset Start address offset in bytes.
+	 * Only words with changed value are written.
+	 * 
+	 * @param startOffset Start offset in image in bytes.
 	 * @param value Pointer to input values to write.
 	 * @param len Length of \c value in bytes.
-	 * @return \c SEEPROM_OF if writing \c len bytes will overflow defined area.
-	 * @return \c SEEPROM_OK is write is successful.
+	 * @return \c SEEPROM_OF if writing \c len bytes will go outside image or EEPROM area is too small.
+	 * @return \c SEEPROM_OK if write is successful.
 	 */
-	uint8_t write(uint16_t startOffset, void* value, uint16_t len);
+	uint8_t write(uint16_t startOffset, const void* value, uint16_t len);
 
 	/**
-	 * @brief Erase \c len words in EEPROM.
+	 * @brief Revert whole image to defaults.
 	 * 
-	 * @param startOffset Start address offset in bytes.
-	 * @param len Number of words to erase.
-	 * @return \c SEEPROM_NOK if \c len is not aligned by 4 bytes.
-	 * @return \c SEEPROM_OF if erasing \c len words will erase words outside defined area.
-	 * @return \c SEEPROM_OK if erasing is successful.
+	 * Only validity bitmap is erased.
+	 * 
+	 * @return \c SEEPROM_OF if EEPROM area is too small.
+	 * @return \c SEEPROM_OK if image is reverted.
 	 */
-	uint8_t erase(uint16_t startOffset, uint16_t len);
+	uint8_t revert(void);
+
+	/**
+	 * @brief Get EEPROM bytes used by validity bitmap.
+	 * 
+	 * @return Bitmap size in bytes.
+	 */
+	inline uint16_t overhead(void) const
+	{
+		return bitmapLen;
+	}
 
 
 	// PRIVATE STUFF
 	private:
 	// VARIABLES
-	uint32_t start = 0x0; /**< @brief EEPROM start address. */
-	uint16_t length = 0x0; /**< @brief EEPROM length in bytes. */
+	sEEPROM* eeprom = nullptr; /**< @brief Pointer to EEPROM object. */
+	const uint8_t* defaults = nullptr; /**< @brief Pointer to default image. */
+	uint16_t length = 0; /**< @brief Default image length in bytes. */
+	uint16_t bitmapLen = 0; /**< @brief Validity bitmap length in bytes. */
 
 	// METHOD DECLARATIONS
 	/**
-	 * @brief Backend write method.
+	 * @brief Check if word is overridden in EEPROM.
 	 * 
-	 * This method handles writes to EEPROM. It is called by main write method.
+	 * @param word Word index in image.
+	 * @return \c true if word is stored in EEPROM.
+	 */
+	bool overridden(uint16_t word);
+
+	/**
+	 * @brief Read bitmap word.
 	 * 
-	 * @tparam T \c value type
-	 * @param startAddr Start address.
-	 * @param value Pointer to array with values of \c T type.
-	 * @param len Number of members in \c value array.
+	 * @param group Bitmap word index(32 image words per bitmap word).
+	 * @return Bitmap word as OR of both copies.
 	 */
-	template<typename T>
-	void write(T* startAddr, T* value, uint16_t len)
+	uint32_t bitmap(uint16_t group);
+
+	/**
+	 * @brief Get current word value.
+	 * 
+	 * @param word Word index in image.
+	 * @return Word value from EEPROM or default image.
+	 */
+	uint32_t current(uint16_t word);
+
+	/**
+	 * @brief Check if range is inside image and EEPROM area.
+	 * 
+	 * @param startOffset Start offset in image in bytes.
+	 * @param len Range length in bytes.
+	 * @return \c true if range is valid.
+	 */
+	inline bool valid(uint16_t startOffset, uint16_t len) const
 	{
-		uint16_t idx = 0;
+		return ((uint32_t)startOffset + len) <= length && ((uint32_t)bitmapLen + ((length + 3) & ~0x3)) <= eeprom->size();
+	}
+};
 
-		do
-		{
-			// Wait for EEPROM if busy
-			while (FLASH->SR & FLASH_SR_BSY);
 
-			// Write value
-			startAddr[idx] = value[idx];
+/**
+ * @brief Result of \ref sEEPROMMigration::migrate.
+ * 
+ */
+struct sEEPROMMigrationStats {
+	uint16_t programmed = 0; /**< @brief Number of programmed data words. */
+	uint16_t progress = 0; /**< @brief Number of programmed progress words. */
+	uint16_t naive = 0; /**< @brief Number of words full rewrite of new layout and version word would program. Compare with \c programmed + \c progress. */
+};
 
-			// Increase index
-			idx++;
-		}
-		while (idx != len);		
-	}
+/**
+ * @brief Schema versioned layout migration.
+ * 
+ * Field moves, resizes, adds and removes are derived from field IDs of old and new \ref sEEPROMSchema.
+ * Moves are ordered so no move overwrites source of pending move, overlapping moves are split into chunks aligned to destination words which do not overlap own source and defaults are written last.
+ * Only words which change are programmed. Number of finished steps is stored in two progress words in turns, so interrupted migration resumes after reboot.
+ * Progress word holds step count in lower half and check of step count and both versions in upper half, so torn progress word is ignored and older one is used.
+ * Progress is stored only before step which overwrites source of step that would otherwise be repeated after reboot and once before new version is stored,
+ * so torn version word is detected and migration is finished after reboot. Progress words are cleared after new version is stored.
+ */
+class sEEPROMMigration {
+	// PUBLIC STUFF
+	public:
+	// STATIC METHOD DECLARATIONS
+	/**
+	 * @brief Migrate EEPROM layout.
+	 * 
+	 * @param eeprom Reference to EEPROM object with layout.
+	 * @param versionOffset Version word offset in bytes. Must be aligned by 4 bytes and outside of all fields.
+	 * @param progressOffset Offset of two progress words in bytes. Must be aligned by 4 bytes and outside of all fields of both layouts.
+	 * @param from Reference to old layout.
+	 * @param to Reference to new layout.
+	 * @param stats Pointer to output statistics or \c nullptr.
+	 * @return \c SEEPROM_NOK if stored version is neither \c from nor \c to version, layout has too many fields or moves depend on each other in cycle.
+	 * @return \c SEEPROM_OK if EEPROM holds \c to layout.
+	 */
+	static uint8_t migrate(sEEPROM& eeprom, uint16_t versionOffset, uint16_t progressOffset, const sEEPROMSchema& from, const sEEPROMSchema& to, sEEPROMMigrationStats* stats = nullptr);
 
+
+	// PRIVATE STUFF
+	private:
+	// STRUCTS
 	/**
-	 * @brief Unlock write access to EEPROM and PECR register.
+	 * @brief Migration run context.
+	 * 
+	 */
+	struct context {
+		sEEPROM* eeprom; /**< @brief Pointer to EEPROM object. */
+		uint16_t versionOffset; /**< @brief Version word offset. */
+		uint16_t progressOffset; /**< @brief Progress words offset. */
+		uint16_t from; /**< @brief Old layout version. */
+		uint16_t to; /**< @brief New layout version. */
+		uint16_t done; /**< @brief Number of steps finished before this run. */
+		uint8_t stored; /**< @brief Valid progress word is stored. */
+		uint8_t slot; /**< @brief Progress word to write next. */
+		uint16_t step; /**< @brief Current step. */
+		uint8_t dry; /**< @brief Only validate plan. */
+		uint8_t sourceCnt; /**< @brief Number of tracked source ranges. */
+		uint16_t sourceFrom[SEEPROM_MIGRATE_SOURCES]; /**< @brief Start offsets of sources of steps finished after last stored progress. */
+		uint16_t sourceTo[SEEPROM_MIGRATE_SOURCES]; /**< @brief End offsets of sources of steps finished after last stored progress. */
+		sEEPROMMigrationStats stats; /**< @brief Statistics. */
+	};
+
+	// STATIC METHOD DECLARATIONS
+	/**
+	 * @brief Execute or validate migration plan.
+	 * 
+	 * @param ctx Reference to run context.
+	 * @param from Reference to old layout.
+	 * @param to Reference to new layout.
+	 * @return \c SEEPROM_NOK if moves depend on each other in cycle.
+	 * @return \c SEEPROM_OK if plan is executed.
+	 */
+	static uint8_t run(context& ctx, const sEEPROMSchema& from, const sEEPROMSchema& to);
+
+	/**
+	 * @brief Find old field with same ID.
 	 * 
+	 * @param schema Reference to old layout.
+	 * @param id Field ID.
+	 * @return Pointer to field or \c nullptr.
+	 */
+	static const sEEPROMField* find(const sEEPROMSchema& schema, uint16_t id);
+
+	/**
+	 * @brief Copy EEPROM range as one plan step.
+	 * 
+	 * @param ctx Reference to run context.
+	 * @param dst Destination offset in bytes.
+	 * @param src Source offset in bytes.
+	 * @param len Number of bytes to copy.
 	 * @return No return value.
 	 */
-	inline void unlockEEPROM(void)
-	{
-		// Wait if flash is busy
-		while (FLASH->SR & FLASH_SR_BSY);
+	static void copyStep(context& ctx, uint16_t dst, uint16_t src, uint16_t len);
 
-		// Write required values to unlock EEPROM and PECR
-		FLASH->PEKEYR = PEKEY_VALUE_1;
-		FLASH->PEKEYR = PEKEY_VALUE_2;
-	}
+	/**
+	 * @brief Write RAM bytes, programming only changed words.
+	 * 
+	 * @param ctx Reference to run context.
+	 * @param dst Destination offset in bytes.
+	 * @param value Pointer to bytes or \c nullptr for zeros.
+	 * @param len Number of bytes.
+	 * @return No return value.
+	 */
+	static void put(context& ctx, uint16_t dst, const uint8_t* value, uint16_t len);
 
 	/**
-	 * @brief Alias for \ref unlockEEPROM
+	 * @brief Start plan step.
+	 * 
+	 * Progress is stored first if step writes over source of any step finished after last stored progress.
+	 * 
+	 * @param ctx Reference to run context.
+	 * @param dst Destination offset in bytes.
+	 * @param len Number of destination bytes.
+	 * @return 1 if step has to be executed, 0 if it was finished before reboot or run only validates plan.
+	 */
+	static uint8_t begin(context& ctx, uint16_t dst, uint16_t len);
+
+	/**
+	 * @brief Finish plan step and remember its source.
 	 * 
+	 * @param ctx Reference to run context.
+	 * @param src Source offset in bytes.
+	 * @param len Number of source bytes or 0 if step has no EEPROM source.
 	 * @return No return value.
 	 */
-	inline void unlockPECR(void)
-	{
-		unlockEEPROM();
-	}
+	static void end(context& ctx, uint16_t src, uint16_t len);
 
 	/**
-	 * @brief Lock write access to EEPROM and PECR register.
+	 * @brief Store number of finished steps in progress word which does not hold newest progress.
 	 * 
+	 * @param ctx Reference to run context.
 	 * @return No return value.
 	 */
-	inline void lockEEPROM(void)
-	{
-		// Wait if flash is busy
-		while (FLASH->SR & FLASH_SR_BSY);
+	static void checkpoint(context& ctx);
 
-		// Lock EEPROM and PECR by writing 1 to PELOCK bit
-		FLASH->PECR |= FLASH_PECR_PELOCK;
-	}
+	/**
+	 * @brief Find newest valid progress word.
+	 * 
+	 * Sets \c done, \c stored and \c slot of \c ctx.
+	 * 
+	 * @param ctx Reference to run context.
+	 * @return No return value.
+	 */
+	static void load(context& ctx);
 
 	/**
-	 * @brief Alias for \ref lockEEPROM
+	 * @brief Store new version and clear progress words.
 	 * 
+	 * @param ctx Reference to run context.
 	 * @return No return value.
 	 */
-	inline void lockPECR(void)
+	static void finish(context& ctx);
+
+	/**
+	 * @brief Calculate progress word check.
+	 * 
+	 * @param ctx Reference to run context.
+	 * @param steps Number of finished steps.
+	 * @return Check of \c steps and both versions.
+	 */
+	static inline uint16_t check(const context& ctx, uint16_t steps)
 	{
-		lockEEPROM();
+		uint16_t key[3] = { steps, ctx.from, ctx.to };
+		uint32_t crc = sEEPROMCRC::crc32(key, sizeof(key));
+
+		return ~((crc >> 16) ^ crc);
 	}
 };
 
 
+/**
+ * @brief EEPROM block with incrementally maintained CRC-32.
+ * 
+ * CRC-32 word of block is stored right after block. On write only changed span is read and CRC is updated with CRC shift math,
+ * so cost is O(\c len + log2(block length)) instead of O(block length).
+ */
+class sEEPROMBlock {
+	// PUBLIC STUFF
+	public:
+	// OBJECT CONSTRUCTORS AND DECONSTRUCTORS
+	/**
+	 * @brief Object constructor.
+	 * 
+	 * @param eeprom Reference to EEPROM object. Must hold \c len bytes plus 4 bytes for CRC-32 from \c startOffset.
+	 * @param startOffset Block start offset in bytes.
+	 * @param len Block length in bytes.
+	 * @return No return value.
+	 */
+	sEEPROMBlock(sEEPROM& eeprom, uint16_t startOffset, uint16_t len);
+
+
+	// METHOD DECLARATIONS
+	/**
+	 * @brief Calculate CRC-32 of current block content and store it.
+	 * 
+	 * Whole block is read. Use it once when block is created.
+	 * 
+	 * @return \c SEEPROM_OF if block goes outside EEPROM area.
+	 * @return \c SEEPROM_OK if CRC-32 is stored.
+	 */
+	uint8_t format(void);
+
+	/**
+	 * @brief Read \c len bytes of block.
+	 * 
+	 * @param offset Offset in block in bytes.
+	 * @param output Pointer to output array.
+	 * @param len Size of \c output array in bytes.
+	 * @return \c SEEPROM_OF if reading \c len bytes will go outside block.
+	 * @return \c SEEPROM_OK if read is successful.
+	 */
+	uint8_t read(uint16_t offset, void* output, uint16_t len);
+
+	/**
+	 * @brief Write \c len bytes of block and update stored CRC-32.
+	 * 
+	 * Stored CRC-32 is updated from XOR of old and new bytes shifted over rest of block. Words which already match are skipped.
+	 * Power loss between data and CRC-32 write is detected by \ref verify.
+	 * 
+	 * @param offset Offset in block in bytes.
+	 * @param value Pointer to input values to write.
+	 * @param len Length of \c value in bytes.
+	 * @return \c SEEPROM_OF if writing \c len bytes will go outside block.
+	 * @return \c SEEPROM_OK if write is successful.
+	 */
+	uint8_t write(uint16_t offset, const void* value, uint16_t len);
+
+	/**
+	 * @brief Check block content against stored CRC-32.
+	 * 
+	 * Whole block is read.
+	 * 
+	 * @return \c SEEPROM_NOK if block is corrupted.
+	 * @return \c SEEPROM_OF if block goes outside EEPROM area.
+	 * @return \c SEEPROM_OK if block is valid.
+	 */
+	uint8_t verify(void);
+
+
+	// PRIVATE STUFF
+	private:
+	// VARIABLES
+	sEEPROM* eeprom = nullptr; /**< @brief Pointer to EEPROM object. */
+	uint16_t start = 0; /**< @brief Block start offset in bytes. */
+	uint16_t length = 0; /**< @brief Block length in bytes. */
+
+	// METHOD DECLARATIONS
+	/**
+	 * @brief Calculate CRC-32 of block content.
+	 * 
+	 * @param crc Reference to output CRC-32.
+	 * @return \c SEEPROM_OF if block goes outside EEPROM area.
+	 * @return \c SEEPROM_OK if CRC-32 is calculated.
+	 */
+	uint8_t calculate(uint32_t& crc);
+};
+
+
 /**@}*/
 
 #else
 #undef SEEPROM_CS
+#ifndef SEEPROM_HOST
 #warning "sEEPROM: Selected chip is not supported!"
+#endif // SEEPROM_HOST
 #endif // STM32L051xx
 
 /**@}*/